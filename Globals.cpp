@@ -1,18 +1,23 @@
 #include "Globals.hpp"
+#include <stdexcept>
 #include <thread> 
 #include "utils.hpp"
+#include "Progress.hpp"
+#include "Numa.hpp"
+#include "Z2Table.hpp"
 #include <boost/program_options.hpp>
 
 namespace po = boost::program_options;
 
 // Threading and performance tracking
-uint8_t THREADS; //store maximum number of threads here
+uint16_t THREADS; //store maximum number of threads here
 omp_lock_t lock;
 std::chrono::high_resolution_clock::time_point tcount_init_time = std::chrono::high_resolution_clock::now(); // Initialize with current time
 std::chrono::duration<double> timeelapsed = std::chrono::duration<double>::zero(); // Initialize as zero
 
 // Pattern handling and search settings
-std::set<pattern> pattern_set;          
+PatternSet pattern_set(Memory::Allocator<pattern>("pattern_set"));
+std::atomic<uint64_t> patterns_remaining(0);
 std::vector<pattern> cases;
 std::string pattern_file = "";
 std::string case_file = "";
@@ -23,7 +28,15 @@ SO6 root = SO6::identity();
 uint8_t target_T_count = 8;            
 uint8_t stored_depth_max = 255;
 uint8_t num_gen_sets = 1;
+uint64_t memory_budget = 0;
 bool cases_flag = false;
+uint8_t census_depth = 0;
+uint8_t prune_depth = 0;
+bool goal_flag = false;
+bool priority_flag = false;
+utils::Order compute_order = utils::Order::Shuffle;
+uint64_t order_seed = 0;
+bool order_benchmark = false;
 
 // // Counters
 int counter_zero = 0;
@@ -37,23 +50,69 @@ void Globals::setParameters(int argc, char *argv[]) {
         int tcount_param;
         int stored_depth_param;
         int threads_param;
+        std::string progress_param;
+        double progress_interval_param;
+        std::string memory_budget_param;
+        std::string pin_param;
+        int interned_lde_param;
+        int census_param;
+        int prune_param;
+        std::string order_param;
 
         desc.add_options()
             ("help,h", "produce help message")
             ("tcount,t", po::value<int>(&tcount_param)->default_value(8), "target T count")
             ("stored_depth,s", po::value<int>(&stored_depth_param)->default_value(0), "maximum stored depth")
+            ("memory_budget,m", po::value<std::string>(&memory_budget_param)->default_value("0"), "memory available to the search, e.g. 64G. If set, the stored depth is chosen (and revised as levels are measured) to fit it")
             ("pattern_file,f", po::value<std::string>(&pattern_file), "pattern file")
             ("verbose,v", po::bool_switch(), "enable verbosity")
             ("threads,n", po::value<std::string>()->default_value(std::to_string(std::thread::hardware_concurrency()-1)), "number of threads")
+            ("pin", po::value<std::string>(&pin_param)->default_value("none"), "thread pinning: none, compact (fill one NUMA node first), spread (round robin over NUMA nodes) or a cpulist such as 0-15,32-47")
+            ("interned_lde", po::value<int>(&interned_lde_param)->default_value(7), "largest LDE whose entries use table-driven arithmetic, at most 7; -1 disables the tables")
             ("root,r", po::value<std::string>(), "set the root of the search tree by specifying a circuit.")
-            ("cases,c", po::bool_switch(&cases_flag), "flag to tell code whether we are looking for specific cases (not used).");
+            ("cases,c", po::bool_switch(&cases_flag), "flag to tell code whether we are looking for specific cases (not used).")
+            ("census", po::value<int>(&census_param)->default_value(0), "instead of searching, expand one matrix per residue pattern up to this T count and report the T count at which each orbit of the pattern file is first reached")
+            ("goal", po::bool_switch(&goal_flag), "stop as soon as every orbit of the pattern file is found")
+            ("prune", po::value<int>(&prune_param)->default_value(0), "sample the pattern transition graph up to this T count from every matrix, and skip matrices it puts too far from every remaining pattern. A heuristic past that T count: the graph holds only the sampled transitions")
+            ("priority", po::bool_switch(&priority_flag), "in the free multiply, take first the stored matrices whose products the residues show to have a remaining pattern, rescoring as patterns are found. Best with --goal")
+            ("order", po::value<std::string>(&order_param)->default_value("shuffle"), "order of the stored matrices in the free multiply: shuffle (seeded), cost (by LDE and sparsity) or residue (by residue pattern). Threads get contiguous chunks of equal estimated cost")
+            ("seed", po::value<uint64_t>(&order_seed)->default_value(0), "seed of the shuffle order, so runs repeat")
+            ("order_benchmark", po::bool_switch(&order_benchmark), "time the last free multiply level under every order and report thread imbalance, no search")
+            ("progress", po::value<std::string>(&progress_param)->default_value("auto"), "progress output: auto, tty (redraw), log (plain lines for batch jobs) or none")
+            ("progress_interval", po::value<double>(&progress_interval_param)->default_value(0), "seconds between progress reports (0 picks 0.5s for tty, 60s for log)");
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
         po::notify(vm);
 
+        // Stored matrices and their T₀ step use 8-bit entries, which hold every LDE up to Z2::max_lde. Deeper levels would
+        // need wider entries, but with the level sizes growing tenfold per T count none of them fits in memory. The stored
+        // depth is at least half the target, so that bounds the target too
+        if (stored_depth_param > max_stored_depth()) {
+            throw std::invalid_argument("stored depth " + std::to_string(stored_depth_param) + " is above " + std::to_string(max_stored_depth())
+                                        + ", the deepest level 8-bit entries can store");
+        }
+        if (tcount_param > 2 * max_stored_depth()) {
+            throw std::invalid_argument("T count " + std::to_string(tcount_param) + " is above " + std::to_string(2 * max_stored_depth())
+                                        + ", the most a stored depth of " + std::to_string(max_stored_depth()) + " reaches");
+        }
         target_T_count = (uint8_t) (std::max(1,tcount_param));
-        stored_depth_max = (uint8_t) stored_depth_param;
+        stored_depth_max = (uint8_t) std::max(0, stored_depth_param);
         num_gen_sets = utils::num_generating_sets(target_T_count, stored_depth_max);
+        memory_budget = Memory::parse_bytes(memory_budget_param);
+        // The census multiplies 8-bit matrices, whose entries hold every LDE up to Z2::max_lde
+        if (census_param > Z2::max_lde) {
+            throw std::invalid_argument("census depth " + std::to_string(census_param) + " is above " + std::to_string(Z2::max_lde)
+                                        + ", the deepest 8-bit entries can expand to");
+        }
+        census_depth = (uint8_t) std::max(0, census_param);
+        // The graph is sampled with 8-bit matrices, whose entries hold every LDE up to Z2::max_lde
+        if (prune_param > Z2::max_lde) {
+            throw std::invalid_argument("prune depth " + std::to_string(prune_param) + " is above " + std::to_string(Z2::max_lde)
+                                        + ", the deepest 8-bit entries can sample to");
+        }
+        prune_depth = (uint8_t) std::max(0, prune_param);
+        compute_order = utils::parse_order(order_param);
+        Progress::configure(Progress::parse_mode(progress_param), progress_interval_param);
    
         if (vm.count("help")) {
             std::cout << desc << "\n";
@@ -64,9 +123,11 @@ void Globals::setParameters(int argc, char *argv[]) {
             if(vm["threads"].as<std::string>() == "max") {
                 THREADS = std::thread::hardware_concurrency();
             } else {
-                THREADS = (uint8_t) std::stoi(vm["threads"].as<std::string>());
+                THREADS = (uint16_t) std::max(1, std::stoi(vm["threads"].as<std::string>()));
             }
         }
+        Numa::configure(pin_param, THREADS);
+        if (interned_lde_param >= 0) Z2Table::build(interned_lde_param);
 
 
     } catch (std::exception& e) {
@@ -78,8 +139,10 @@ void Globals::setParameters(int argc, char *argv[]) {
 // Configure run based on global parameters
 void Globals::configure()
 {
-    if (stored_depth_max == 0 || stored_depth_max > target_T_count-1) stored_depth_max = target_T_count-1;
+    if (stored_depth_max == 0 || stored_depth_max > target_T_count-1) stored_depth_max = std::min(target_T_count-1, max_stored_depth());
     if (stored_depth_max < std::ceil((float)target_T_count/2)) stored_depth_max = (uint8_t) std::ceil((float)target_T_count/2); 
+    if (memory_budget) replan(0, 0);
+    num_gen_sets = utils::num_generating_sets(target_T_count, stored_depth_max);
     
     if (THREADS > std::thread::hardware_concurrency()) {
         THREADS = std::thread::hardware_concurrency();
@@ -90,7 +153,29 @@ void Globals::configure()
     // Output configuration
     std::cout << "[Config] Generating up to T=" << (int) target_T_count << ".\n";
     std::cout << "[Config] Storing at most T=" << (int) stored_depth_max << " in memory.\n";
-    std::cout << "[Config] Running on " << (int) THREADS << " threads.\n";
+    if (memory_budget) std::cout << "[Config] Memory budget " << Memory::format_bytes(memory_budget) << ", stored depth is revised after every level.\n";
+    std::cout << "[Config] Running on " << (int) THREADS << " threads, " << Numa::describe() << ".\n";
+    if (Z2Table::built()) std::cout << "[Config] Entries up to LDE " << Z2Table::max_lde() << " interned as " << Z2Table::size() << " ordinals.\n";
+    if (goal_flag && pattern_file.empty()) {
+        goal_flag = false;
+        std::cout << "[Config] Goal-driven search needs a pattern file, searching to T=" << (int) target_T_count << ".\n";
+    }
+    if (goal_flag) std::cout << "[Config] Stopping once every pattern is found.\n";
+    if (prune_depth && pattern_file.empty()) {
+        prune_depth = 0;
+        std::cout << "[Config] Pruning needs a pattern file, not pruning.\n";
+    }
+    if (prune_depth) std::cout << "[Config] Pruning with the pattern graph sampled up to T=" << (int) prune_depth << ".\n";
+    std::cout << "[Config] Free multiply order " << utils::order_name(compute_order);
+    if (compute_order == utils::Order::Shuffle) std::cout << " with seed " << order_seed;
+    std::cout << ".\n";
+    if (order_benchmark) std::cout << "[Config] Benchmarking the free multiply orders, no search.\n";
+    if (priority_flag && pattern_file.empty()) {
+        priority_flag = false;
+        std::cout << "[Config] Prioritising needs a pattern file, not prioritising.\n";
+    }
+    if (priority_flag) std::cout << "[Config] Multiplying the stored matrices most likely to hit a remaining pattern first.\n";
+    if (census_depth) std::cout << "[Config] Pattern census up to T=" << (int) census_depth << ", no search.\n";
     if (!pattern_file.empty()) {
         std::cout << "[Config] Searching for patterns in file " << pattern_file << "\n";
     } else {
@@ -135,4 +220,40 @@ void Globals::configure()
     // SO6 case_representative = SO6::reconstruct_from_circuit_string("5 2 0 6 12 1 4 13 12 4 2 9 0");
 }
 
+/**
+ * @brief Chooses stored_depth_max (and num_gen_sets) from the memory budget.
+ *        Called by configure() before the search and after every BFS level with the measured sizes.
+ * @param completed number of BFS levels built so far
+ * @param sets_saved number of generating sets saved so far
+ * @return whether stored_depth_max changed
+ */
+bool Globals::replan(const int &completed, const int &sets_saved)
+{
+    // Until a level is measured, assume one tree node plus a typical identity-like matrix
+    static const uint64_t default_bytes = sizeof(SO6) + 32 + SO6::identity().heap_footprint();
+    static uint64_t predicted = 0;
+    uint64_t measured = completed ? Memory::predict_level_size(completed) : 0;
+
+    // pattern_set with the heap of its patterns, and its index of up to four 16-byte slots and 4 filter bytes per pattern
+    const uint64_t fixed_bytes = (uint64_t) Memory::account("pattern_set")->bytes() + Memory::sampled_heap_bytes(pattern_set)
+                               + pattern_set.size() * (4 * 16 + 4);
+    const int gen_copies = Numa::pinned() && Numa::num_nodes() > 1 ? Numa::num_nodes() + 1 : 1;
+    Memory::Plan plan = Memory::plan_stored_depth(target_T_count, memory_budget, default_bytes, completed, sets_saved, fixed_bytes, gen_copies,
+                                                  max_stored_depth());
+    if (!plan.feasible && completed == 0) {
+        std::cout << "[Config] Warning: no stored depth fits the memory budget of " << Memory::format_bytes(memory_budget)
+                  << ", the smallest needs ~" << Memory::format_bytes(plan.peak_bytes) << ".\n";
+    }
+    if (completed && predicted && measured > predicted) {
+        std::cout << " ||\t↪ [Plan] T=" << completed << " has " << measured << " matrices, " << predicted << " were predicted. Replanning.\n";
+    }
+    predicted = Memory::predict_level_size(completed + 1);
 
+    if (plan.stored_depth == stored_depth_max) return false;
+    stored_depth_max = (uint8_t) plan.stored_depth;
+    num_gen_sets = (uint8_t) plan.generating_sets;
+    std::cout << (completed ? " ||\t↪ [Plan] " : "[Config] ") << "Memory budget " << Memory::format_bytes(memory_budget)
+              << ": storing at most T=" << (int) stored_depth_max << " with " << (int) num_gen_sets
+              << " generating sets, predicted peak ~" << Memory::format_bytes(plan.peak_bytes) << (completed ? ".\n ||" : ".") << std::endl;
+    return true;
+}
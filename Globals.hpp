@@ -3,6 +3,7 @@
 #ifndef GLOBALS_HPP
 #define GLOBALS_HPP
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <set>
@@ -11,15 +12,19 @@
 #include <omp.h>
 #include "pattern.hpp" // Assuming this is your custom class
 #include "SO6.hpp"     // Assuming this is your custom class
+#include "Memory.hpp"
+#include "utils.hpp"
 
 // Threading and performance tracking
-extern uint8_t THREADS;
+extern uint16_t THREADS;
 extern omp_lock_t lock;
 extern std::chrono::high_resolution_clock::time_point tcount_init_time;
 extern std::chrono::duration<double> timeelapsed;
 
 // Pattern handling and search settings
-extern std::set<pattern> pattern_set;
+using PatternSet = std::set<pattern, std::less<pattern>, Memory::Allocator<pattern>>;
+extern PatternSet pattern_set;
+extern std::atomic<uint64_t> patterns_remaining;   // pattern_set.size(), safe to read while workers erase
 extern std::set<pattern> case_set;
 extern std::vector<pattern> cases;
 // extern std::set<SO6> explicit_search_set;
@@ -33,11 +38,19 @@ extern std::string root_string;
 extern uint8_t target_T_count;
 extern uint8_t stored_depth_max;
 extern uint8_t num_gen_sets;
+extern uint64_t memory_budget;     // bytes available for the search, 0 if stored_depth_max is not planned
 extern bool saveResults;
 extern bool verbose;
 extern bool transpose_multiply;
 extern bool explicit_search_mode;
 extern bool cases_flag;
+extern uint8_t census_depth;       // T count of the pattern census, 0 for the usual search
+extern bool goal_flag;             // stop the search once every orbit of the pattern file is found
+extern uint8_t prune_depth;        // T count the pattern graph is sampled to, 0 if the search is not pruned
+extern bool priority_flag;         // multiply the stored matrices most likely to hit a remaining pattern first
+extern utils::Order compute_order; // order of the stored matrices in the free multiply
+extern uint64_t order_seed;        // seed of the shuffle order
+extern bool order_benchmark;       // time one free multiply level under every order instead of searching
 
 // Counters
 extern int counter_zero;
@@ -48,5 +61,8 @@ class Globals {
     public:
         static void setParameters(int argc, char *argv[]);
         static void configure();
+        static bool replan(const int &, const int &);
+        /// @brief Deepest level that can be stored: its T₀ step must stay within the LDE of 8-bit entries.
+        static inline int max_stored_depth() { return Z2::max_lde - 1; }
 };
 #endif // GLOBALS_HPP
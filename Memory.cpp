@@ -0,0 +1,311 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "Memory.hpp"
+
+static std::mutex registry_lock;
+static std::deque<MemoryAccount> &registry()
+{
+    static std::deque<MemoryAccount> accounts;   // deque never relocates, so pointers stay valid
+    return accounts;
+}
+
+static std::deque<NodePool> &pools()
+{
+    static std::deque<NodePool> p;
+    return p;
+}
+
+static std::vector<std::pair<uint64_t,uint64_t>> level_stats;   // (matrices, bytes) indexed by T count
+
+/**
+ * @brief Shard of the calling thread, assigned round robin on first use.
+ */
+int MemoryAccount::shard_index()
+{
+    static std::atomic<int> next_shard(0);
+    thread_local int index = next_shard.fetch_add(1, std::memory_order_relaxed) % num_shards;
+    return index;
+}
+
+int64_t MemoryAccount::bytes() const
+{
+    int64_t sum = 0;
+    for (const Shard &s : shards) sum += s.bytes.load(std::memory_order_relaxed);
+    return sum;
+}
+
+int64_t MemoryAccount::objects() const
+{
+    int64_t sum = 0;
+    for (const Shard &s : shards) sum += s.objects.load(std::memory_order_relaxed);
+    return sum;
+}
+
+/**
+ * @brief Updates the recorded peak with the current total and returns it.
+ */
+int64_t MemoryAccount::sample_peak()
+{
+    int64_t current = bytes();
+    int64_t p = peak.load(std::memory_order_relaxed);
+    while (current > p && !peak.compare_exchange_weak(p, current, std::memory_order_relaxed));
+    return std::max(p, current);
+}
+
+/**
+ * @brief Returns the account with the given name, creating it on first use.
+ * @param name label printed in the memory report, e.g. "level T=4" or "generating_set[0]"
+ */
+MemoryAccount *Memory::account(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (MemoryAccount &a : registry()) {
+        if (a.name == name) return &a;
+    }
+    registry().emplace_back(name);
+    return &registry().back();
+}
+
+/**
+ * @brief Returns the node pool with the given name, creating it on first use.
+ * @param name e.g. "level T=4" or "thread buffer[3]"
+ */
+NodePool *Memory::pool(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (NodePool &p : pools()) {
+        if (p.name == name) return &p;
+    }
+    pools().emplace_back(name);
+    return &pools().back();
+}
+
+/**
+ * @brief Maps a new slab, twice the size of the previous one up to 32MB.
+ */
+void NodePool::grow()
+{
+    constexpr std::size_t huge_page = 2 * 1024 * 1024;
+    std::size_t size = std::max(next_slab, 64 * block_size);
+    next_slab = std::min<std::size_t>(next_slab * 2, 32 * 1024 * 1024);
+
+    void *slab;
+    if (size >= huge_page) {
+        // Over-map by one huge page so the slab can start on a 2MB boundary, then trim
+        size = (size + huge_page - 1) & ~(huge_page - 1);
+        char *raw = static_cast<char*>(mmap(nullptr, size + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + huge_page - 1) & ~(huge_page - 1));
+        if (aligned > raw) munmap(raw, aligned - raw);
+        if (aligned + size < raw + size + huge_page) munmap(aligned + size, raw + size + huge_page - (aligned + size));
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        slab = aligned;
+    } else {
+        slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slab == MAP_FAILED) throw std::bad_alloc();
+    }
+    slabs.emplace_back(slab, size);
+    reserved_bytes += size;
+    cursor = static_cast<char*>(slab);
+    slab_end = cursor + size;
+}
+
+/**
+ * @brief Unmaps every slab at once. Everything allocated from the pool must already have been destroyed.
+ */
+void NodePool::release()
+{
+    for (auto &slab : slabs) munmap(slab.first, slab.second);
+    slabs.clear();
+    reserved_bytes = 0;
+    free_list = nullptr;
+    cursor = slab_end = nullptr;
+    next_slab = 64 * 1024;
+}
+
+/**
+ * @brief Records the measured size of a completed level for footprint prediction.
+ * @param t T count of the level
+ * @param matrices number of matrices stored at that level
+ * @param bytes bytes held by the level, including the heap owned by its elements
+ */
+void Memory::record_level(const int &t, const uint64_t &matrices, const uint64_t &bytes)
+{
+    if (t < 0) return;
+    if ((int) level_stats.size() <= t) level_stats.resize(t + 1, {0, 0});
+    level_stats[t] = {matrices, bytes};
+}
+
+/**
+ * @brief Predicts the number of matrices at level t from the measured growth of the previous levels.
+ *        The growth ratio of the last two levels is reused, which overestimates since growth shrinks with T.
+ * @param t T count of the level to predict
+ * @return the recorded size if level t has been measured, otherwise the extrapolated size
+ */
+uint64_t Memory::predict_level_size(const int &t)
+{
+    if (t < (int) level_stats.size() && level_stats[t].first) return level_stats[t].first;
+    int last = std::min<int>(t, level_stats.size()) - 1;
+    while (last >= 0 && level_stats[last].first == 0) last--;
+    if (last < 0) return (uint64_t) std::pow(15.0, t);
+
+    double growth = 15;   // Each matrix has at most 15 children
+    if (last >= 1 && level_stats[last-1].first) growth = (double) level_stats[last].first / level_stats[last-1].first;
+    growth = std::clamp(growth, 1.0, 15.0);
+
+    double n = level_stats[last].first;
+    for (int k = last; k < t; k++) n *= growth;
+    return (uint64_t) n;
+}
+
+/**
+ * @brief Chooses the stored depth that minimizes the predicted work while fitting a memory budget.
+ *
+ * Levels that have not been measured are extrapolated by predict_level_size, which starts from the
+ * worst case growth of 15, so an early plan is conservative and later plans can only grow the stored depth
+ * as measurements come in. The BFS phase needs levels k-2, k-1 and k to build level k, and the free multiply
+ * needs the stored level plus the generating sets T₀{T=k}, which hold about 14/15 of level k. Between the two, the
+ * stored set and the vector it is copied into are alive together, and the generating sets are copied once per NUMA
+ * node while the originals are still held. fixed_bytes, held throughout, covers pattern_set and its index.
+ * The work counts one unit per T multiplication in the BFS and free_multiply_weight units per full product.
+ *
+ * @param T target T count
+ * @param budget available bytes
+ * @param default_bytes bytes per matrix to assume until a level has been measured
+ * @param completed number of BFS levels already built; the stored depth cannot be smaller
+ * @param sets_saved number of generating sets already saved; sets below completed cannot be created anymore
+ * @param fixed_bytes bytes held for the whole search whatever the depth
+ * @param gen_copies copies of the generating sets alive at once while they are replicated, 1 without replication
+ * @param max_depth deepest stored level the entries can hold
+ * @return the cheapest feasible plan, or the smallest-memory plan flagged infeasible
+ */
+Memory::Plan Memory::plan_stored_depth(const int &T, const uint64_t &budget, const uint64_t &default_bytes, const int &completed, const int &sets_saved,
+                                       const uint64_t &fixed_bytes, const int &gen_copies, const int &max_depth)
+{
+    constexpr double free_multiply_weight = 4;   // A full SO6 product costs roughly four T multiplications
+    uint64_t b = bytes_per_matrix();
+    if (b == 0) b = default_bytes;
+
+    Plan best = {std::min(T - 1, max_depth), 0, UINT64_MAX, INFINITY, false};
+    int min_depth = std::max((int) std::ceil(T / 2.0), completed);
+    for (int d = std::max(1, min_depth); d <= std::max(1, std::min(T - 1, max_depth)); d++) {
+        int ngs = std::max(0, std::min(T - 1 - d, d));
+        if (std::min(ngs, completed) > sets_saved) continue;   // Would need a coset that was not saved
+
+        double gens = 0;
+        for (int k = 0; k < ngs; k++) gens += predict_level_size(k + 1) * 14.0 / 15;
+
+        double bfs_peak = 0, bfs_work = 0;
+        for (int k = 1; k <= d; k++) {
+            double live = predict_level_size(k) + predict_level_size(k - 1) + (k >= 2 ? predict_level_size(k - 2) : 0);
+            bfs_peak = std::max(bfs_peak, live);
+            bfs_work += 15.0 * predict_level_size(k - 1);
+        }
+        double stored = predict_level_size(d);
+        double free_work = stored;   // T=d+1 only multiplies by T₀
+        for (int k = 0; k < T - 1 - d; k++) free_work += stored * predict_level_size(k + 1) * 14.0 / 15 * free_multiply_weight;
+
+        // BFS, then the stored set converted to a vector, then the generating sets replicated next to the vector
+        double live = std::max({bfs_peak + gens, 2 * stored + gens, stored + gens * std::max(1, gen_copies)});
+        uint64_t peak = (uint64_t) (live * b) + fixed_bytes;
+        Plan p = {d, ngs, peak, bfs_work + free_work, peak <= budget};
+        if (p.feasible && (!best.feasible || p.cost <= best.cost)) best = p;
+        else if (!best.feasible && !p.feasible && p.peak_bytes < best.peak_bytes) best = p;
+    }
+    return best;
+}
+
+/**
+ * @brief Parses a byte count with an optional K, M, G or T suffix (powers of 1024), e.g. "64G".
+ */
+uint64_t Memory::parse_bytes(const std::string &s)
+{
+    std::size_t pos = 0;
+    double value = std::stod(s, &pos);
+    std::string suffix = s.substr(pos);
+    if (!suffix.empty() && (suffix.back() == 'B' || suffix.back() == 'b')) suffix.pop_back();
+    double scale = 1;
+    if (suffix.empty()) scale = 1;
+    else if (suffix == "K" || suffix == "k") scale = 1024.0;
+    else if (suffix == "M" || suffix == "m") scale = 1024.0 * 1024;
+    else if (suffix == "G" || suffix == "g") scale = 1024.0 * 1024 * 1024;
+    else if (suffix == "T" || suffix == "t") scale = 1024.0 * 1024 * 1024 * 1024;
+    else throw std::invalid_argument("cannot parse memory size '" + s + "'");
+    return (uint64_t) (value * scale);
+}
+
+/**
+ * @brief Bytes per stored matrix measured on the most recent level, or 0 if nothing has been measured.
+ */
+uint64_t Memory::bytes_per_matrix()
+{
+    for (int t = (int) level_stats.size() - 1; t >= 0; t--) {
+        if (level_stats[t].first) return level_stats[t].second / level_stats[t].first;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sum of the live bytes of every account.
+ */
+uint64_t Memory::tracked_bytes()
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+    int64_t sum = 0;
+    for (const MemoryAccount &a : registry()) sum += a.bytes();
+    return sum > 0 ? sum : 0;
+}
+
+/**
+ * @brief Resident set size of the process in bytes, read from /proc/self/statm.
+ */
+uint64_t Memory::rss()
+{
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * (uint64_t) sysconf(_SC_PAGESIZE);
+}
+
+std::string Memory::format_bytes(const double &b)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (b < 1024) ss << b << "B";
+    else if (b < 1024.0 * 1024) ss << b / 1024 << "KB";
+    else if (b < 1024.0 * 1024 * 1024) ss << b / (1024.0 * 1024) << "MB";
+    else ss << b / (1024.0 * 1024 * 1024) << "GB";
+    return ss.str();
+}
+
+/**
+ * @brief Prints the bytes, object counts and peaks of every account that has been used.
+ * @param phase label of the phase boundary being reported
+ */
+void Memory::report(const std::string &phase)
+{
+    std::stringstream ss;
+    ss << " ||\t↪ [Memory] " << phase << ": RSS " << format_bytes(rss()) << "\n";
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (MemoryAccount &a : registry()) {
+        int64_t p = a.sample_peak();
+        if (p == 0) continue;   // Never used
+        ss << " ||\t↪ [Memory]     " << std::left << std::setw(20) << a.name << std::right
+           << format_bytes(a.bytes()) << " in " << a.objects() << " objects (peak " << format_bytes(p) << ")\n";
+    }
+    std::size_t reserved = 0;
+    for (const NodePool &p : pools()) reserved += p.reserved();
+    if (reserved) ss << " ||\t↪ [Memory]     " << std::left << std::setw(20) << "node pools" << std::right << format_bytes(reserved) << " reserved\n";
+    std::cout << ss.str() << std::flush;
+}
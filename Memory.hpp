@@ -0,0 +1,204 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+/**
+ * @brief A named counter of live bytes and objects. Accounts are created once and never destroyed,
+ *        so allocators may hold raw pointers to them.
+ *
+ * Counters are sharded by thread so that the per-thread buffers, which all share one account, do not
+ * bounce a single cache line between cores on every node allocation. The peak is sampled every
+ * 1024 allocations per shard and at every report.
+ */
+class MemoryAccount {
+    public:
+        explicit MemoryAccount(const std::string &n) : name(n) {}
+
+        inline void add(const int64_t &b, const int64_t &n) {
+            Shard &s = shards[shard_index()];
+            s.bytes.fetch_add(b, std::memory_order_relaxed);
+            s.objects.fetch_add(n, std::memory_order_relaxed);
+            if ((s.allocations.fetch_add(1, std::memory_order_relaxed) & 1023) == 0) sample_peak();
+        }
+        inline void remove(const int64_t &b, const int64_t &n) {
+            Shard &s = shards[shard_index()];
+            s.bytes.fetch_sub(b, std::memory_order_relaxed);
+            s.objects.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+        int64_t bytes() const;
+        int64_t objects() const;
+        int64_t sample_peak();
+
+        const std::string name;
+
+    private:
+        static constexpr int num_shards = 16;
+        struct alignas(64) Shard {
+            std::atomic<int64_t> bytes{0};
+            std::atomic<int64_t> objects{0};
+            std::atomic<uint64_t> allocations{0};
+        };
+        static int shard_index();
+
+        Shard shards[num_shards];
+        std::atomic<int64_t> peak{0};
+};
+
+/**
+ * @brief Pool of equally sized blocks carved from large slabs, used for the tree nodes of the level sets
+ *        and per-thread buffers. The heap owned by the elements, such as SO6::hist, still comes from malloc.
+ *
+ * Freed blocks go on an intrusive free list and are reused, so clearing and refilling a buffer never touches malloc.
+ * Slabs double in size up to 32MB. Slabs of 2MB or more are 2MB aligned and advised for transparent huge pages.
+ * release() returns every slab at once; it may only be called once nothing allocated from the pool is alive.
+ * A pool is not thread safe. Each thread buffer has its own pool, and a level set is only modified inside
+ * the critical section or by the main thread.
+ */
+class NodePool {
+    public:
+        explicit NodePool(const std::string &n) : name(n) {}
+        ~NodePool() { release(); }
+
+        /**
+         * @brief Returns a block of the pool's size, or nullptr if bytes is not that size (the caller falls back to the heap).
+         *        The block size is fixed by the first request.
+         */
+        inline void *allocate(const std::size_t &bytes) {
+            std::size_t rounded = (bytes + 15) & ~std::size_t(15);
+            if (block_size == 0) block_size = rounded;
+            if (rounded != block_size) return nullptr;
+            if (free_list) {
+                void *p = free_list;
+                free_list = *static_cast<void **>(free_list);
+                return p;
+            }
+            if (cursor + block_size > slab_end) grow();
+            void *p = cursor;
+            cursor += block_size;
+            return p;
+        }
+
+        /// @brief Whether a block of this many bytes would be served by the pool.
+        inline bool serves(const std::size_t &bytes) const { return ((bytes + 15) & ~std::size_t(15)) == block_size; }
+
+        inline void deallocate(void *p) {
+            *static_cast<void **>(p) = free_list;
+            free_list = p;
+        }
+
+        void release();
+        std::size_t reserved() const { return reserved_bytes; }
+
+        const std::string name;
+
+    private:
+        void grow();
+
+        std::size_t block_size = 0;
+        void *free_list = nullptr;
+        char *cursor = nullptr;
+        char *slab_end = nullptr;
+        std::size_t next_slab = 64 * 1024;
+        std::size_t reserved_bytes = 0;
+        std::vector<std::pair<void*, std::size_t>> slabs;
+};
+
+/**
+ * @file Memory.hpp
+ * @brief Memory accounting for the level sets, generating sets, pattern set and per-thread buffers.
+ */
+class Memory {
+    public:
+        /**
+         * @brief Stateful allocator that charges every allocation to a MemoryAccount.
+         *
+         * The account propagates on copy, move and swap, so when utils::rotate_and_clear swaps level sets
+         * the bytes stay charged to the level that allocated them. If a NodePool is attached, single-object
+         * allocations (the tree nodes of std::set) are served from it and it travels with the container in the same way.
+         */
+        template <typename T>
+        class Allocator {
+            public:
+                using value_type = T;
+                using propagate_on_container_copy_assignment = std::true_type;
+                using propagate_on_container_move_assignment = std::true_type;
+                using propagate_on_container_swap = std::true_type;
+
+                Allocator() : account(Memory::account("untracked")) {}
+                explicit Allocator(MemoryAccount *a, NodePool *p = nullptr) : account(a), pool(p) {}
+                explicit Allocator(const std::string &name) : account(Memory::account(name)) {}
+                Allocator(const std::string &name, NodePool *p) : account(Memory::account(name)), pool(p) {}
+                template <typename U> Allocator(const Allocator<U> &other) : account(other.account), pool(other.pool) {}
+
+                T *allocate(std::size_t n) {
+                    account->add(n * sizeof(T), n);
+                    if (pool && n == 1) {
+                        void *p = pool->allocate(sizeof(T));
+                        if (p) return static_cast<T*>(p);
+                    }
+                    return std::allocator<T>().allocate(n);
+                }
+                void deallocate(T *p, std::size_t n) {
+                    account->remove(n * sizeof(T), n);
+                    if (pool && n == 1 && pool->serves(sizeof(T))) {
+                        pool->deallocate(p);
+                        return;
+                    }
+                    std::allocator<T>().deallocate(p, n);
+                }
+
+                template <typename U> bool operator==(const Allocator<U> &other) const { return account == other.account && pool == other.pool; }
+                template <typename U> bool operator!=(const Allocator<U> &other) const { return !(*this == other); }
+
+                MemoryAccount *account;
+                NodePool *pool = nullptr;
+        };
+
+        static MemoryAccount *account(const std::string &);
+        static NodePool *pool(const std::string &);
+
+        /**
+         * @brief Estimates the heap owned by the elements of a container (e.g. SO6::hist) from a prefix sample.
+         * @param c container whose value_type provides heap_footprint()
+         * @param samples number of elements to inspect
+         * @return estimated bytes held outside the container's own nodes
+         */
+        template <typename Container>
+        static uint64_t sampled_heap_bytes(const Container &c, const std::size_t samples = 1024) {
+            if (c.empty()) return 0;
+            uint64_t sum = 0;
+            std::size_t n = 0;
+            for (auto it = c.begin(); it != c.end() && n < samples; ++it, ++n) sum += it->heap_footprint();
+            return (uint64_t) ((double) sum / n * c.size());
+        }
+
+        /**
+         * @brief Outcome of plan_stored_depth.
+         */
+        struct Plan {
+            int stored_depth;       // deepest level kept in memory
+            int generating_sets;    // number of cosets T₀{T=k} kept for the free multiply
+            uint64_t peak_bytes;    // predicted peak over the BFS and free multiply phases
+            double cost;            // predicted work in units of one T multiplication
+            bool feasible;          // whether peak_bytes fits the budget
+        };
+
+        static Plan plan_stored_depth(const int &, const uint64_t &, const uint64_t &, const int &, const int &, const uint64_t &, const int &, const int &);
+        static uint64_t parse_bytes(const std::string &);
+        static void record_level(const int &, const uint64_t &, const uint64_t &);
+        static uint64_t predict_level_size(const int &);
+        static uint64_t bytes_per_matrix();
+        static uint64_t tracked_bytes();
+        static uint64_t rss();
+        static void report(const std::string &);
+        static std::string format_bytes(const double &);
+};
+
+#endif // MEMORY_HPP
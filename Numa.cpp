@@ -0,0 +1,136 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <sched.h>
+#include "Numa.hpp"
+
+Numa::Policy Numa::policy = Numa::Policy::None;
+std::vector<int> Numa::thread_cpu;
+std::vector<int> Numa::cpu_node;
+int Numa::nodes = 1;
+
+/**
+ * @brief Parses a Linux cpulist such as "0-15,32-47".
+ */
+static std::vector<int> parse_cpulist(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        std::size_t dash = range.find('-');
+        int lo = std::stoi(range.substr(0, dash));
+        int hi = (dash == std::string::npos) ? lo : std::stoi(range.substr(dash + 1));
+        for (int c = lo; c <= hi; c++) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+/**
+ * @brief Reads the NUMA topology and builds the thread to CPU map for the requested policy.
+ * @param pin none, compact (fill one node before the next), spread (round robin over nodes) or an explicit cpulist
+ * @param threads number of threads in the team
+ */
+void Numa::configure(const std::string &pin, const unsigned int &threads)
+{
+    // CPUs this process may run on (respects Slurm/cgroup restrictions)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    // Node of each allowed CPU, one node if sysfs has no topology
+    std::vector<std::vector<int>> node_cpus;
+    for (int n = 0; ; n++) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!f.is_open()) break;
+        std::string list;
+        std::getline(f, list);
+        std::vector<int> cpus;
+        for (int c : parse_cpulist(list)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        if (!cpus.empty()) node_cpus.push_back(cpus);
+    }
+    if (node_cpus.empty()) {
+        node_cpus.emplace_back();
+        for (int c = 0; c < CPU_SETSIZE; c++) if (CPU_ISSET(c, &allowed)) node_cpus[0].push_back(c);
+    }
+    nodes = node_cpus.size();
+    cpu_node.assign(CPU_SETSIZE, 0);
+    for (int n = 0; n < nodes; n++) for (int c : node_cpus[n]) cpu_node[c] = n;
+
+    thread_cpu.clear();
+    if (pin == "none" || pin.empty()) {
+        policy = Policy::None;
+    } else if (pin == "compact") {
+        policy = Policy::Compact;
+        for (const std::vector<int> &cpus : node_cpus) thread_cpu.insert(thread_cpu.end(), cpus.begin(), cpus.end());
+    } else if (pin == "spread") {
+        policy = Policy::Spread;
+        std::size_t longest = 0;
+        for (const std::vector<int> &cpus : node_cpus) longest = std::max(longest, cpus.size());
+        for (std::size_t i = 0; i < longest; i++) {
+            for (const std::vector<int> &cpus : node_cpus) if (i < cpus.size()) thread_cpu.push_back(cpus[i]);
+        }
+    } else {
+        policy = Policy::List;
+        thread_cpu = parse_cpulist(pin);
+        for (int c : thread_cpu) {
+            if (c < 0 || c >= CPU_SETSIZE || !CPU_ISSET(c, &allowed)) throw std::invalid_argument("cpu " + std::to_string(c) + " in --pin is not available");
+        }
+    }
+    if (policy != Policy::None && thread_cpu.empty()) policy = Policy::None;
+    if (policy != Policy::None && threads > thread_cpu.size()) {
+        std::cout << "[Config] Warning: " << threads << " threads pinned to " << thread_cpu.size() << " CPUs, CPUs will be shared.\n";
+    }
+}
+
+/**
+ * @brief Pins the calling thread to the CPU assigned to thread id tid. Does nothing without a pinning policy.
+ *        Cheap enough to call at the start of every parallel region.
+ */
+void Numa::pin_thread(const int &tid)
+{
+    if (policy == Policy::None) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(thread_cpu[tid % thread_cpu.size()], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+/**
+ * @brief NUMA node that thread id tid runs on. Without pinning this is the node of the CPU it currently runs on.
+ */
+int Numa::node_of_thread(const int &tid)
+{
+    if (policy == Policy::None) {
+        int cpu = sched_getcpu();
+        return (cpu >= 0 && cpu < (int) cpu_node.size()) ? cpu_node[cpu] : 0;
+    }
+    return cpu_node[thread_cpu[tid % thread_cpu.size()]];
+}
+
+int Numa::num_nodes()
+{
+    return nodes;
+}
+
+bool Numa::pinned()
+{
+    return policy != Policy::None;
+}
+
+std::string Numa::describe()
+{
+    std::string ret = std::to_string(nodes) + " NUMA node" + (nodes > 1 ? "s" : "") + ", ";
+    switch (policy) {
+        case Policy::None: return ret + "threads not pinned";
+        case Policy::Compact: return ret + "threads pinned compactly";
+        case Policy::Spread: return ret + "threads spread over nodes";
+        case Policy::List: return ret + "threads pinned to the given CPUs";
+    }
+    return ret;
+}
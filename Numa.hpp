@@ -0,0 +1,33 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file Numa.hpp
+ * @brief Thread pinning and NUMA topology for the OpenMP team.
+ *
+ * The topology is read from /sys/devices/system/node, so no NUMA library is needed. Memory placement relies on
+ * the kernel's default first-touch policy: data touched first by a pinned thread lands on that thread's node.
+ */
+class Numa {
+    public:
+        enum class Policy { None, Compact, Spread, List };
+
+        static void configure(const std::string &, const unsigned int &);
+        static void pin_thread(const int &);
+        static int node_of_thread(const int &);
+        static int num_nodes();
+        static bool pinned();
+        static std::string describe();
+
+    private:
+        static Policy policy;
+        static std::vector<int> thread_cpu;    // CPU of each thread id, cycled if there are more threads than entries
+        static std::vector<int> cpu_node;      // NUMA node of each CPU id
+        static int nodes;
+};
+
+#endif // NUMA_HPP
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <deque>
+#include <set>
+#include <omp.h>
+#include "PatternGraph.hpp"
+#include "Numa.hpp"
+
+std::map<pattern, int> PatternGraph::index;
+std::vector<pattern> PatternGraph::patterns;
+std::vector<std::vector<int>> PatternGraph::parents;
+std::vector<bool> PatternGraph::open;
+std::vector<uint8_t> PatternGraph::dist;
+
+/**
+ * @brief Samples the graph by a BFS over every matrix up to depth, one per class up to signed column permutations as
+ *        in the search. Every product adds an edge from the pattern of its factor to its own, so the transitions of
+ *        every matrix of T count below depth are in the graph. The patterns first seen at depth are left open.
+ * @param root matrix to start from
+ * @param depth largest T count to expand to
+ */
+void PatternGraph::build(const SO6 &root, const int &depth)
+{
+    pattern root_pattern = root.to_pattern();
+    root_pattern.hist.clear();
+    index = {{root_pattern, 0}};
+    patterns = {root_pattern};
+    parents.assign(1, {});
+
+    std::set<SO6> prior, current = {root};
+    std::vector<int> new_nodes = {0};
+    for (int t = 1; t <= depth && !current.empty(); t++)
+    {
+        // Each thread finds the distinct edges and products of its share of the level, reading index only
+        std::vector<const SO6*> level;
+        level.reserve(current.size());
+        for (const SO6 &S : current) level.push_back(&S);
+        std::vector<std::set<std::pair<int, pattern>>> edges_by(THREADS);
+        std::vector<std::set<SO6>> next_by(THREADS);
+        #pragma omp parallel num_threads(THREADS)
+        {
+            int thread_id = omp_get_thread_num();
+            Numa::pin_thread(thread_id);
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < level.size(); i++)
+            {
+                pattern from = level[i]->to_pattern();
+                from.hist.clear();
+                const int from_node = index.at(from);
+                for (int T = 0; T < 15; T++)
+                {
+                    SO6 N = level[i]->left_multiply_by_T(T);
+                    pattern p = N.to_pattern();
+                    p.hist.clear();
+                    edges_by[thread_id].emplace(from_node, std::move(p));
+                    next_by[thread_id].insert(std::move(N));
+                }
+            }
+        }
+
+        // New nodes are numbered in thread order, so the graph only depends on the thread count
+        std::set<SO6> next;
+        for (std::set<SO6> &products : next_by) next.merge(products);
+        for (const SO6 &S : prior) next.erase(S);
+        new_nodes.clear();
+        for (std::set<std::pair<int, pattern>> &edges : edges_by)
+        {
+            for (const std::pair<int, pattern> &edge : edges)
+            {
+                auto [it, added] = index.emplace(edge.second, patterns.size());
+                if (added) {
+                    new_nodes.push_back(patterns.size());
+                    patterns.push_back(edge.second);
+                    parents.emplace_back();
+                }
+                parents[it->second].push_back(edge.first);
+            }
+        }
+        prior.swap(current);
+        current.swap(next);
+    }
+    for (std::vector<int> &p : parents)
+    {
+        std::sort(p.begin(), p.end());
+        p.erase(std::unique(p.begin(), p.end()), p.end());
+    }
+    open.assign(patterns.size(), false);
+    for (const int &node : new_nodes) open[node] = true;
+    dist.clear();
+}
+
+/**
+ * @brief Labels every node with its distance to the nearest target, by a BFS backwards from the targets and from the
+ *        open nodes, which might lead anywhere.
+ * @param targets the patterns still to be found
+ */
+void PatternGraph::label(const PatternSet &targets)
+{
+    dist.assign(patterns.size(), unreachable);
+    std::deque<int> queue;
+    for (std::size_t node = 0; node < patterns.size(); node++)
+    {
+        if (!open[node] && targets.find(patterns[node]) == targets.end()) continue;
+        dist[node] = 0;
+        queue.push_back(node);
+    }
+    while (!queue.empty())
+    {
+        const int node = queue.front();
+        queue.pop_front();
+        if (dist[node] + 1 >= unreachable) continue;
+        for (const int &parent : parents[node])
+        {
+            if (dist[parent] != unreachable) continue;
+            dist[parent] = dist[node] + 1;
+            queue.push_back(parent);
+        }
+    }
+}
+
+/**
+ * @brief Node of a pattern, which stays valid across labellings.
+ * @return -1 for a pattern missing from the graph
+ */
+int PatternGraph::node(const pattern &p)
+{
+    auto it = index.find(p);
+    return it == index.end() ? -1 : it->second;
+}
+
+/**
+ * @brief Distance from a node to the nearest target, as labelled.
+ * @return 0 for a pattern missing from the graph
+ */
+uint8_t PatternGraph::distance(const int &node)
+{
+    return node < 0 ? 0 : dist[node];
+}
+
+uint8_t PatternGraph::distance(const pattern &p)
+{
+    return distance(node(p));
+}
+
+std::size_t PatternGraph::num_edges()
+{
+    std::size_t ret = 0;
+    for (const std::vector<int> &p : parents) ret += p.size();
+    return ret;
+}
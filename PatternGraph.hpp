@@ -0,0 +1,48 @@
+#ifndef PATTERNGRAPH_HPP
+#define PATTERNGRAPH_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Globals.hpp"
+#include "SO6.hpp"
+#include "pattern.hpp"
+
+/**
+ * @file PatternGraph.hpp
+ * @brief Directed graph of residue patterns under the 15 T gates, with distances to the remaining targets.
+ *
+ * The pattern of T_i S is not a function of the pattern of S: matrices sharing a pattern often lead to different ones,
+ * for about a quarter of the transitions at T=4. So the graph is sampled by a BFS over every matrix up to its depth,
+ * and holds every transition out of a matrix below that depth. Patterns whose successors were not expanded count as
+ * distance 0, as do patterns missing from the graph, so pruning never discards them. A path that leaves the sampled
+ * depth can still pass through a transition the graph lacks, which is what makes pruning an opt-in heuristic. Memory
+ * grows with the matrices up to the depth, as for stored levels.
+ */
+class PatternGraph {
+    public:
+        static constexpr uint8_t unreachable = 255;
+
+        static void build(const SO6 &, const int &);
+        static void label(const PatternSet &);
+        static int node(const pattern &);
+        static uint8_t distance(const int &);
+        static uint8_t distance(const pattern &);
+
+        /// @brief True if the graph is not built, or if a sampled path of at most budget T gates leads from the pattern of S to a target.
+        static inline bool can_reach(const SO6 &S, const int &budget) {
+            return dist.empty() || distance(S.to_pattern()) <= budget;
+        }
+        static inline bool built() { return !patterns.empty(); }
+        static inline std::size_t size() { return patterns.size(); }
+        static std::size_t num_edges();
+
+    private:
+        static std::map<pattern, int> index;            // pattern, without history, to node
+        static std::vector<pattern> patterns;           // node to pattern
+        static std::vector<std::vector<int>> parents;   // nodes with an edge into each node
+        static std::vector<bool> open;                  // nodes whose successors were not expanded
+        static std::vector<uint8_t> dist;               // T gates to the nearest target, set by label
+};
+
+#endif // PATTERNGRAPH_HPP
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include "PatternIndex.hpp"
+
+std::vector<PatternIndex::Slot, Memory::Allocator<PatternIndex::Slot>> PatternIndex::slots(Memory::Allocator<Slot>("pattern_index"));
+int PatternIndex::shift = 64;
+std::vector<uint64_t, Memory::Allocator<uint64_t>> PatternIndex::filter(Memory::Allocator<uint64_t>("pattern_filter"));
+int PatternIndex::filter_shift = 64;
+std::size_t PatternIndex::erased = 0;
+std::size_t PatternIndex::indexed = 0;
+
+/**
+ * @brief Indexes every pattern of a set, in a table at most half full, and builds the filter over them.
+ * @param targets the patterns still to be found
+ */
+void PatternIndex::build(const PatternSet &targets)
+{
+    int bits = 6;
+    while ((std::size_t) 1 << bits < 2 * targets.size()) bits++;
+    shift = 64 - bits;
+    std::vector<Slot, Memory::Allocator<Slot>>((std::size_t) 1 << bits, slots.get_allocator()).swap(slots);
+    for (Slot &s : slots) s.store(Key{empty, empty});
+    for (const pattern &p : targets) {
+        const Key k = key(p);
+        std::size_t s = slot(k);
+        while (slots[s].first() != empty) s = (s + 1) & (slots.size() - 1);
+        slots[s].store(k);
+    }
+
+    // The filter has 16 bits per pattern, and at most 2^32 words so that the word and the bits use apart bits of the hash
+    int filter_log_words = 1;
+    while ((std::size_t) 64 << filter_log_words < 16 * targets.size() && filter_log_words < 32) filter_log_words++;
+    filter_shift = 64 - filter_log_words;
+    filter.assign((std::size_t) 1 << filter_log_words, 0);
+    for (const pattern &p : targets) {
+        const uint64_t h = filter_hash(key(p));
+        filter[h >> filter_shift] |= filter_bits(h);
+    }
+    indexed = targets.size();
+    erased = 0;
+}
+
+bool PatternIndex::contains(const Key &k)
+{
+    if (slots.empty() || !may_contain(k)) return false;
+    for (std::size_t s = slot(k); slots[s].first() != empty; s = (s + 1) & (slots.size() - 1)) {
+        if (slots[s].holds(k)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Leaves a tombstone in the slot of a pattern, if it is indexed. Callers hold the lock guarding pattern_set.
+ */
+void PatternIndex::erase(const pattern &p)
+{
+    if (slots.empty()) return;
+    const Key k = key(p);
+    for (std::size_t s = slot(k); slots[s].first() != empty; s = (s + 1) & (slots.size() - 1)) {
+        if (!slots[s].holds(k)) continue;
+        slots[s].store(Key{tombstone, tombstone});
+        erased++;
+        return;
+    }
+}
+
+/// @brief True once a sixteenth of the indexed patterns were erased, so that the filter lets through notably more keys
+///        than it would if rebuilt.
+bool PatternIndex::stale()
+{
+    return erased > 0 && erased * 16 >= indexed;
+}
+
+/**
+ * @brief Bits of a pattern in the layout of SO6::residue: bit col*6+row of the first word is the first bit of the
+ *        entry, and of the second word its second bit.
+ */
+PatternIndex::Key PatternIndex::key(const pattern &p)
+{
+    Key k = {0, 0};
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            k[0] |= (uint64_t) p.arr[col][row].first << (col * 6 + row);
+            k[1] |= (uint64_t) p.arr[col][row].second << (col * 6 + row);
+        }
+    }
+    return k;
+}
+
+/**
+ * @brief Key of the pattern of bit-packed residues in the layout of SO6::residue, equal to key(SO6::residue_pattern())
+ *        without building the pattern. Columns are sorted as by pattern::lexicographic_order: by their pairs, row 0 first,
+ *        larger first.
+ */
+PatternIndex::Key PatternIndex::key(const uint64_t *residues)
+{
+    // Two bits per row, the pair of row 0 most significant
+    uint16_t code[6];
+    for (int col = 0; col < 6; col++) {
+        code[col] = 0;
+        for (int row = 0; row < 6; row++) {
+            const int i = col * 6 + row;
+            code[col] = code[col] << 2 | (residues[0] >> i & 1) << 1 | (residues[1] >> i & 1);
+        }
+    }
+    for (int i = 1; i < 6; i++) {
+        for (int j = i; j > 0 && code[j] > code[j-1]; j--) std::swap(code[j], code[j-1]);
+    }
+
+    Key k = {0, 0};
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            k[0] |= (uint64_t) (code[col] >> (11 - 2 * row) & 1) << (col * 6 + row);
+            k[1] |= (uint64_t) (code[col] >> (10 - 2 * row) & 1) << (col * 6 + row);
+        }
+    }
+    return k;
+}
+
+/**
+ * @brief Pattern of a key, as it was indexed and without history.
+ */
+pattern PatternIndex::to_pattern(const Key &k)
+{
+    pattern ret;
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            ret.arr[col][row].first = k[0] >> (col * 6 + row) & 1;
+            ret.arr[col][row].second = k[1] >> (col * 6 + row) & 1;
+        }
+    }
+    return ret;
+}
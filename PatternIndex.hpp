@@ -0,0 +1,84 @@
+#ifndef PATTERNINDEX_HPP
+#define PATTERNINDEX_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Globals.hpp"
+#include "pattern.hpp"
+
+/**
+ * @file PatternIndex.hpp
+ * @brief Flat hash set of the patterns still to be found, probed by the free multiply instead of pattern_set.
+ *
+ * A pattern is keyed by its bits in the layout of SO6::residue, so two patterns share a key exactly when they compare
+ * equal. Products are keyed straight from their residues, without building their pattern. Slots are open addressed with linear probing. Patterns are erased under the lock that guards pattern_set by
+ * leaving a tombstone, which keeps every probe sequence intact, while threads keep probing. Slot words are atomics read
+ * and written relaxed, so a probe racing an erase sees the key or the tombstone in each word, never a torn word. A slot
+ * seen half erased matches no key, as the tombstone is never a key, and its probe goes on past it.
+ *
+ * In front of the table is a blocked Bloom filter, 16 bits per pattern with the 4 bits of a key in one 64-bit word, small
+ * enough to stay in cache while the table does not. Nearly every product misses, and most misses stop at the filter.
+ * Erased patterns stay in the filter, which only costs false positives, until enough are erased that the index is
+ * rebuilt between levels.
+ */
+class PatternIndex {
+    public:
+        using Key = std::array<uint64_t, 2>;
+
+        static void build(const PatternSet &);
+        static void erase(const pattern &);
+        static bool contains(const Key &);
+        static bool stale();
+        static Key key(const pattern &);
+        static Key key(const uint64_t *);
+        static pattern to_pattern(const Key &);
+
+        /// @brief First slot probed for a key, so that probes sorted by it walk the table in order.
+        static inline std::size_t slot(const Key &k) {
+            return (k[0] * 0x9E3779B97F4A7C15ull ^ k[1] * 0xC2B2AE3D27D4EB4Full) >> shift;
+        }
+        /// @brief False if the pattern of a key is surely not indexed, in a few instructions.
+        static inline bool may_contain(const Key &k) {
+            const uint64_t h = filter_hash(k);
+            return (filter[h >> filter_shift] & filter_bits(h)) == filter_bits(h);
+        }
+        static inline bool built() { return !slots.empty(); }
+        static inline std::size_t capacity() { return slots.size(); }
+
+    private:
+        // Keys have 36 bits per word, so these are never keys
+        static constexpr uint64_t empty = ~0ull;
+        static constexpr uint64_t tombstone = ~0ull - 1;
+
+        struct Slot {
+            std::atomic<uint64_t> word[2];
+            inline uint64_t first() const { return word[0].load(std::memory_order_relaxed); }
+            inline bool holds(const Key &k) const {
+                return word[0].load(std::memory_order_relaxed) == k[0] && word[1].load(std::memory_order_relaxed) == k[1];
+            }
+            inline void store(const Key &k) {
+                word[0].store(k[0], std::memory_order_relaxed);
+                word[1].store(k[1], std::memory_order_relaxed);
+            }
+        };
+
+        static std::vector<Slot, Memory::Allocator<Slot>> slots;
+        static int shift;   // 64 - log2 of the capacity
+        static std::vector<uint64_t, Memory::Allocator<uint64_t>> filter;
+        static int filter_shift;    // 64 - log2 of the words of the filter
+        static std::size_t erased;  // patterns erased since the last build
+        static std::size_t indexed; // patterns indexed by the last build
+
+        // The top bits of the hash pick the word of the filter, bits 8 to 31 the 4 bits in it
+        static inline uint64_t filter_hash(const Key &k) {
+            uint64_t h = k[0] * 0xFF51AFD7ED558CCDull ^ k[1] * 0xC4CEB9FE1A85EC53ull;
+            return (h ^ h >> 32) * 0x9E3779B97F4A7C15ull;
+        }
+        static inline uint64_t filter_bits(const uint64_t &h) {
+            return 1ull << (h >> 8 & 63) | 1ull << (h >> 14 & 63) | 1ull << (h >> 20 & 63) | 1ull << (h >> 26 & 63);
+        }
+};
+
+#endif // PATTERNINDEX_HPP
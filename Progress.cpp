@@ -0,0 +1,182 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+#include "Progress.hpp"
+
+Progress::Mode Progress::output_mode = Progress::Mode::Auto;
+double Progress::interval_seconds = 0;
+
+/**
+ * @brief Formats a duration in seconds the same way the rest of the reports do.
+ */
+static std::string format_seconds(const double &s)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (s < 60) ss << s << "s";
+    else if (s < 3600) ss << s / 60 << "min";
+    else if (s < 86400) ss << s / 3600 << "hr";
+    else ss << s / 86400 << "days";
+    return ss.str();
+}
+
+/**
+ * @brief Formats a count with a k/M/G suffix.
+ */
+static std::string format_count(const double &c)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (c < 1e3) ss << c;
+    else if (c < 1e6) ss << c / 1e3 << "k";
+    else if (c < 1e9) ss << c / 1e6 << "M";
+    else ss << c / 1e9 << "G";
+    return ss.str();
+}
+
+Progress::~Progress()
+{
+    end();
+}
+
+/**
+ * @brief Parses the value of --progress.
+ * @param s one of auto, tty, log or none
+ * @return the corresponding mode
+ */
+Progress::Mode Progress::parse_mode(const std::string &s)
+{
+    if (s == "auto") return Mode::Auto;
+    if (s == "tty") return Mode::Tty;
+    if (s == "log") return Mode::Log;
+    if (s == "none") return Mode::None;
+    throw std::invalid_argument("unknown progress mode '" + s + "' (expected auto, tty, log or none)");
+}
+
+/**
+ * @brief Sets the output mode and the sampling interval for every subsequent phase.
+ * @param m the requested mode. Auto resolves to Tty if stdout is a terminal and Log otherwise.
+ * @param seconds sampling interval. Zero selects 0.5s for Tty and 60s for Log.
+ */
+void Progress::configure(Mode m, double seconds)
+{
+    if (m == Mode::Auto) m = isatty(STDOUT_FILENO) ? Mode::Tty : Mode::Log;
+    output_mode = m;
+    if (seconds <= 0) seconds = (m == Mode::Tty) ? 0.5 : 60;
+    interval_seconds = seconds;
+}
+
+Progress::Mode Progress::mode()
+{
+    return output_mode;
+}
+
+/**
+ * @brief Starts tracking a phase and launches the reporter thread.
+ * @param t total number of work items in the phase
+ * @param threads number of worker threads that will call tick()
+ * @param r optional counter of remaining patterns, read by the reporter instead of pattern_set.size()
+ */
+void Progress::begin(uint64_t t, unsigned int threads, const std::atomic<uint64_t> *r)
+{
+    end();
+    if (output_mode == Mode::Auto) configure(Mode::Auto, interval_seconds);
+
+    num_counters = std::max(1u, threads);
+    counters.reset(new Counter[num_counters]);
+    total = t;
+    remaining = r;
+    start_time = std::chrono::steady_clock::now();
+    stopping.store(false);
+
+    if (output_mode == Mode::None) return;
+    if (output_mode == Mode::Tty) {
+        std::cout << "\n\n";  // Reserve the two lines the reporter redraws
+        print(0, 0, false);
+    }
+    reporter = std::thread(&Progress::run, this);
+}
+
+/**
+ * @brief Stops the reporter thread and prints the final state of the phase.
+ */
+void Progress::end()
+{
+    if (!reporter.joinable()) return;
+    stopping.store(true);
+    reporter.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    uint64_t done = sample();
+    print(done, elapsed > 0 ? done / elapsed : 0, true);
+}
+
+uint64_t Progress::sample() const
+{
+    uint64_t sum = 0;
+    for (unsigned int i = 0; i < num_counters; i++) sum += counters[i].value.load(std::memory_order_relaxed);
+    return sum;
+}
+
+/**
+ * @brief Reporter loop. Wakes every interval, estimates throughput with an exponential moving average and prints.
+ *        Sleeps in short slices so that end() never waits a full (possibly 60s) interval.
+ */
+void Progress::run()
+{
+    const auto interval = std::chrono::duration<double>(interval_seconds);
+    const auto slice = std::chrono::milliseconds(50);
+    auto last_time = start_time;
+    uint64_t last_done = 0;
+    double rate = 0;
+    while (!stopping.load()) {
+        if (std::chrono::steady_clock::now() - last_time < interval) {
+            std::this_thread::sleep_for(slice);
+            continue;
+        }
+        auto t = std::chrono::steady_clock::now();
+        uint64_t done = sample();
+        double dt = std::chrono::duration<double>(t - last_time).count();
+        double instant = dt > 0 ? (done - last_done) / dt : 0;
+        rate = (rate == 0) ? instant : 0.3 * instant + 0.7 * rate;
+        last_time = t;
+        last_done = done;
+        print(done, rate, false);
+    }
+}
+
+/**
+ * @brief Prints one progress report.
+ * @param done number of completed work items
+ * @param rate estimated items per second
+ * @param final whether this is the closing report of the phase
+ */
+void Progress::print(const uint64_t &done, const double &rate, const bool final)
+{
+    if (output_mode == Mode::None) return;
+    double fraction = total ? std::min(1.0, (double) done / total) : 1.0;
+    if (final) fraction = 1.0;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (output_mode == Mode::Tty) {
+        ss << "\033[A\033[A\r ||\t↪ [Progress] Processing .....    " << (100 * fraction) << "%";
+        if (rate > 0) ss << "  " << format_count(rate) << "/s";
+        if (!final && rate > 0 && total > done) ss << "  ETA " << format_seconds((total - done) / rate);
+        ss << "\033[K\n ||\t↪ [Patterns] ";
+        if (remaining) ss << remaining->load(std::memory_order_relaxed) << " patterns remain.";
+        ss << "\033[K" << std::endl;
+    } else {
+        ss << " ||\t↪ [Progress] " << (100 * fraction) << "% (" << done << "/" << total << ")";
+        if (rate > 0) ss << " " << format_count(rate) << "/s";
+        if (final) ss << " in " << format_seconds(elapsed);
+        else if (rate > 0 && total > done) ss << " ETA " << format_seconds((total - done) / rate);
+        if (remaining) ss << ", " << remaining->load(std::memory_order_relaxed) << " patterns remain";
+        ss << std::endl;
+    }
+    std::cout << ss.str() << std::flush;
+}
@@ -0,0 +1,64 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Progress and ETA reporting for the BFS and free multiply phases.
+ *
+ * Each worker owns one cache-line sized counter that only it writes, so the hot path is a relaxed
+ * load/store on a private line. A separate reporter thread samples the counters at a fixed interval
+ * and prints throughput and an ETA, either by redrawing the terminal (TTY) or as plain log lines for batch jobs.
+ */
+class Progress {
+    public:
+        enum class Mode { Auto, Tty, Log, None };
+
+        Progress() = default;
+        ~Progress();
+        Progress(const Progress &) = delete;
+        Progress &operator=(const Progress &) = delete;
+
+        void begin(uint64_t total, unsigned int threads, const std::atomic<uint64_t> *remaining);
+        void end();
+
+        /**
+         * @brief Records n completed work items for thread tid. Only thread tid may call this for its slot.
+         */
+        inline void tick(const unsigned int &tid, const uint64_t n = 1) {
+            std::atomic<uint64_t> &c = counters[tid].value;
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        static Mode parse_mode(const std::string &);
+        static void configure(Mode, double);
+        static Mode mode();
+
+    private:
+        struct alignas(64) Counter {
+            std::atomic<uint64_t> value{0};
+        };
+
+        uint64_t sample() const;
+        void run();
+        void print(const uint64_t &, const double &, const bool);
+
+        std::unique_ptr<Counter[]> counters;
+        unsigned int num_counters = 0;
+        uint64_t total = 0;
+        const std::atomic<uint64_t> *remaining = nullptr;
+        std::chrono::steady_clock::time_point start_time;
+
+        std::thread reporter;
+        std::atomic<bool> stopping{false};
+
+        static Mode output_mode;
+        static double interval_seconds;
+};
+
+#endif // PROGRESS_HPP
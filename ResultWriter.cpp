@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include "ResultWriter.hpp"
+
+ResultWriter::~ResultWriter()
+{
+    end();
+}
+
+/**
+ * @brief Starts writing to a stream, with one ring per worker thread.
+ */
+void ResultWriter::begin(std::ostream &o, unsigned int threads)
+{
+    end();
+    num_rings = std::max(1u, threads);
+    rings.reset(new Ring[num_rings]);
+    out = &o;
+    stopping.store(false);
+    writer = std::thread(&ResultWriter::run, this);
+}
+
+/**
+ * @brief Writes every queued record and flushes the stream. Workers must be done pushing.
+ */
+void ResultWriter::end()
+{
+    if (!writer.joinable()) return;
+    stopping.store(true);
+    writer.join();
+    out = nullptr;
+}
+
+/**
+ * @brief Moves every queued record into buffer.
+ * @return the number of records moved
+ */
+std::size_t ResultWriter::drain(std::string &buffer)
+{
+    std::size_t moved = 0;
+    for (unsigned int i = 0; i < num_rings; i++) {
+        Ring &r = rings[i];
+        const uint64_t head = r.head.load(std::memory_order_relaxed);
+        const uint64_t tail = r.tail.load(std::memory_order_acquire);
+        for (uint64_t k = head; k < tail; k++) {
+            std::string &record = r.records[k % ring_size];
+            buffer += record;
+            buffer += '\n';
+            std::string().swap(record);
+        }
+        r.head.store(tail, std::memory_order_release);
+        moved += tail - head;
+    }
+    return moved;
+}
+
+void ResultWriter::run()
+{
+    const auto slice = std::chrono::milliseconds(1);
+    std::string buffer;
+    buffer.reserve(block_size);
+    while (true) {
+        // Read the flag first, so that a drain after it sees every record pushed before end()
+        const bool last = stopping.load();
+        const std::size_t moved = drain(buffer);
+        if (buffer.size() >= block_size || (!moved && !buffer.empty()) || last) {
+            out->write(buffer.data(), buffer.size());
+            buffer.clear();
+            if (!moved || last) out->flush();
+        }
+        if (last) return;
+        if (!moved) std::this_thread::sleep_for(slice);
+    }
+}
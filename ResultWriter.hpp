@@ -0,0 +1,60 @@
+#ifndef RESULTWRITER_HPP
+#define RESULTWRITER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Writes the circuits found by the free multiply on a thread of its own.
+ *
+ * Each worker owns a single-producer ring of records that only it pushes to, so recording a hit is a string move and
+ * a release store. A writer thread drains the rings into one buffer and writes it in large blocks, flushing the stream
+ * whenever the rings run dry, so workers never wait on I/O. A worker only waits if its ring is full.
+ */
+class ResultWriter {
+    public:
+        ResultWriter() = default;
+        ~ResultWriter();
+        ResultWriter(const ResultWriter &) = delete;
+        ResultWriter &operator=(const ResultWriter &) = delete;
+
+        void begin(std::ostream &, unsigned int threads);
+        void end();
+
+        /**
+         * @brief Queues one record, written as a line. Only thread tid may call this for its ring.
+         */
+        inline void push(const unsigned int &tid, std::string &&record) {
+            Ring &r = rings[tid];
+            const uint64_t tail = r.tail.load(std::memory_order_relaxed);
+            while (tail - r.head.load(std::memory_order_acquire) == ring_size) std::this_thread::yield();
+            r.records[tail % ring_size] = std::move(record);
+            r.tail.store(tail + 1, std::memory_order_release);
+        }
+
+    private:
+        static constexpr uint64_t ring_size = 1024;
+        static constexpr std::size_t block_size = 1 << 20;
+
+        struct Ring {
+            std::unique_ptr<std::string[]> records{new std::string[ring_size]};
+            alignas(64) std::atomic<uint64_t> head{0};  // written by the writer thread
+            alignas(64) std::atomic<uint64_t> tail{0};  // written by the owning worker
+        };
+
+        std::size_t drain(std::string &);
+        void run();
+
+        std::unique_ptr<Ring[]> rings;
+        unsigned int num_rings = 0;
+        std::ostream *out = nullptr;
+
+        std::thread writer;
+        std::atomic<bool> stopping{false};
+};
+
+#endif // RESULTWRITER_HPP
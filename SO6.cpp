@@ -7,80 +7,21 @@
 #include "SO6.hpp"
 #include "pattern.hpp"
 #include "Globals.hpp"
+#include "utils.hpp"
 
 /**
- * Method to compare two Z2 arrays of length 6 lexicographically
- * we are given the guarantee that the first nonzero element in the row is non-negative
- * @param first array of Z2 of length 6
- * @param second array of Z2 of length 6
- * @return -1 if first < second, 0 if equal, 1 if first > second
+ * Compares column col1 of this with column col2 of other as they appear in the canonical view, i.e. with rows read
+ * in Row order. Each column is normalized so that its first nonzero entry is positive, so the result does not depend on column signs.
+ * @param col1 column of this in view order
+ * @param other matrix holding the second column
+ * @param col2 column of other in view order
+ * @return std::strong_ordering::less if the column of this comes first in the canonical order
  */
-int8_t SO6::lexicographical_compare(const Z2 first[6],const Z2 second[6])
+std::strong_ordering SO6::lex_order(const int &col1, const SO6 &other, const int &col2) const
 {
-    bool first_is_negative = false;
-    bool second_is_negative = false;
-    int row;
-    // We search for the first nonzero row of first and if on the way we encounter a nonzero row of second, 
-    // we immediately claim second is larger. If both are nonzero, we compare them
-    // the goal is to "fix" the sign convention of the row so that the entire
-    // column is sorted such that the top element is positive by multiplying everything by -1
-    for (row = 0; row < 6; row++)
-    {
-        if (first[row].intPart == 0) {
-            if(second[row].intPart == 0) {
-                continue;
-            }
-            return 1;
-        }
-        if (second[row].intPart == 0) {
-            return -1;
-        }
-
-        // Now both first and second are nonzero
-        // first_is_negative = first[row].is_negative();
-        first_is_negative = (first[row].intPart < 0) ;
-        second_is_negative = (second[row].intPart < 0);
-        break;
-    }
-
-    // compare remaining rows until return
-    if(!first_is_negative) {
-        if(!second_is_negative) {
-        while (row < 6) {
-                if(first[row] == second[row]) {
-                    row++;
-                    continue;
-                }
-                if(second[row] < first[row]) return -1;
-                return 1;
-            }
-            return 0;
-        }
-        for (row; row < 6; row++)
-            {
-                if(first[row] == -second[row]) continue;
-                if(-second[row] < first[row]) return -1;
-                return 1;
-            }
-        return 0;
-    }
-    //first is negative now
-    if(!second_is_negative) {
-        for (row; row < 6; row++) {
-                if(-first[row] == second[row]) continue;
-                if(second[row] < -first[row]) return -1;
-                return 1;
-            }
-        return 0;
-    }
-
-    //both are negative
-    for (int i = row; i < 6; i++)    {
-        if(first[i] == second[i]) continue;
-        if(-second[i] < -first[i]) return -1;
-        return 1;
-    }
-    return 0;
+    Iterator first = begin() + (col1 << 2) + (col1 << 1);
+    Iterator second = other.begin() + (col2 << 2) + (col2 << 1);
+    return utils::lex_order(first, first + 6, second, second + 6);
 }
 
 /**
@@ -159,76 +100,6 @@ int8_t SO6::lexicographical_compare(const Z2 first[6],const Z2 second[6])
 //     return 0;
 // }
 
-bool SO6::lexicographical_less(const int &col1,const int & col2)
-{
-    bool first_is_negative = false;
-    bool second_is_negative = false;
-    int row;
-
-    for (row = 0; row < 6; row++)
-    {
-        if (arr[get_index(row,col1)].intPart == 0) {
-            if(arr[get_index(row,col2)].intPart == 0) {
-                continue;
-            }
-            return false;
-        }
-        if (arr[get_index(row,col2)].intPart == 0) {
-            return true;
-        }
-        // Now both first and second are nonzero
-        // first_is_negative = arr[get_index(col1,row)].is_negative();
-        first_is_negative = (arr[get_index(row,col1)].intPart < 0) ;
-        second_is_negative = (arr[get_index(row,col2)].intPart < 0);
-        break;
-    }
-
-    // compare remaining rows until return
-    if(!first_is_negative) {
-        if(!second_is_negative) {
-            for (row; row < 6; ++row) {
-                    if(arr[get_index(row,col2)] < arr[get_index(row,col1)])  return true;
-                    if(arr[get_index(row,col1)] < arr[get_index(row,col2)]) return false;
-                }
-            return false;
-        }
-        for (row; row < 6; ++row) {
-                if(-arr[get_index(row,col2)] < arr[get_index(row,col1)])  return true;
-                if(arr[get_index(row,col1)] < -arr[get_index(row,col2)])  return false;
-            }
-        return false;
-    }
-
-    //first is negative now
-    if(!second_is_negative) {
-        for (row; row < 6; ++row) {
-                    if(-arr[get_index(row,col1)] < arr[get_index(row,col2)]) return false;
-                    if(arr[get_index(row,col2)] < -arr[get_index(row,col1)]) return true;
-            }
-        return false;
-    }
-
-    //both are negative
-    for (row; row < 6; ++row)    {
-        if(-arr[get_index(row,col1)] < -arr[get_index(row,col2)]) return false;
-        if(-arr[get_index(row,col2)] == -arr[get_index(row,col1)]) continue;
-        return true;
-    }
-    return false;
-}
-
-
-/**
- * Method to compare two Z2 arrays of length 6 lexicographically
- * @param first array of Z2 of length 6
- * @param second array of Z2 of length 6
- * @return -1 if first < second, 0 if equal, 1 if first > second
- */
-bool SO6::lexicographical_less(const Z2 first[6],const Z2 second[6])
-{
-    return (SO6::lexicographical_compare(first,second)<0);
-}
-
 // /**
 //  * Method to compare two Z2 arrays of length 6 lexicographically
 //  * @param first array of Z2 of length 6
@@ -257,9 +128,12 @@ SO6::SO6(Z2 other[6][6])
 {
     for(int col =0; col<6; col++) {
         for(int row=0; row <6; row++) {
-            *this[col][row]=other[col][row];
+            (*this)[col][row]=other[col][row];
         }
     }
+    update_lde();
+    update_residue();
+    canonical_form();
 }
 
 // Something much faster than this would be a "multiply by T" method that explicitly does the matrix multiplication given a particular T matrix instead of trying to compute it naively
@@ -279,19 +153,22 @@ SO6 SO6::operator*(const SO6 &other) const
     std::copy(other.hist.begin(), other.hist.end(), std::back_inserter(prod.hist));
     std::copy(hist.begin(), hist.end(), std::back_inserter(prod.hist));
 
-    for (int row = 0; row < 6; ++row)
+    // Column col of the product is the sum over the nonzero other[col][k] of column k of this scaled by it, one batched
+    // add per term. The nonzero entries are visited through a bitmask, zeros within the columns of this need no skipping.
+    for (int col = 0; col < 6; ++col)
     {
-        for (int k = 0; k < 6; ++k)
+        for (unsigned bits = other.nonzero_mask(col); bits; bits &= bits - 1)
         {
-            const Z2& left_element = *this[k][row];
-            if (left_element.intPart == 0) continue;    
-            for (int col = 0; col < 6; ++col)
-            { 
-                if((other[col][k]).intPart == 0) continue; 
-                prod[col][row] += (left_element * other[col][k]); 
-            }
+            const int k = __builtin_ctz(bits);
+            const Z2& scalar = other[col][k];
+            Z2 term[6];
+            Z2::multiply(term, (*this)[k], scalar, 6);
+            Z2::add(prod[col], term, 6);
         }
+        prod.update_column_lde(col);
     }
+    prod.update_matrix_lde();
+    prod.update_residue();
     return prod;
 }
 
@@ -311,7 +188,7 @@ SO6 SO6::operator*(const pattern &other) const
     {
         for (int k = 0; k < 6; ++k)
         {
-            const Z2& left_element = *this[k][row];            
+            const Z2& left_element = (*this)[k][row];            
             if (left_element.intPart == 0) continue;    
             
             Z2 smallerLDE = left_element;
@@ -324,6 +201,8 @@ SO6 SO6::operator*(const pattern &other) const
             }
         }
     }
+    prod.update_lde();
+    prod.update_residue();
     return prod;
 }
 
@@ -351,12 +230,18 @@ SO6 SO6::left_multiply_by_T(const int &row1, const int &row2, const unsigned cha
 
     for (int col = 0; col < 6; col++)
     {
-        prod.get_element(row1,col) += arr[(col<<2) + (col<<1) + row2];
-        prod.get_element(row1,col).increaseDE();
-        prod.get_element(row2,col) -= arr[(col<<2) + (col<<1) + row1];
-        prod.get_element(row2,col).increaseDE();
+        const int old_rows_lde = std::max<int>(get_element(row1, col).exponent, get_element(row2, col).exponent);
+        if (!prod.interned_t_step(row1, row2, col)) {
+            prod.get_element(row1,col) += arr[(col<<2) + (col<<1) + row2];
+            prod.get_element(row1,col).increaseDE();
+            prod.get_element(row2,col) -= arr[(col<<2) + (col<<1) + row1];
+            prod.get_element(row2,col).increaseDE();
+        }
+        prod.update_column_lde(row1, row2, col, old_rows_lde);
     }
-    prod.lexicographic_order();
+    prod.update_matrix_lde();
+    prod.update_residue(row1, row2, getLDE());
+    prod.canonical_form(row1, row2);
     prod.update_history(p);
     return prod;
 }
@@ -366,15 +251,25 @@ SO6 SO6::left_multiply_by_T(const int &row1, const int &row2, const unsigned cha
 /// @return the result T_i * this
 SO6 SO6::left_multiply_by_T(const int &i) const
 {
-    if (i < 5)
-        return left_multiply_by_T(0, i + 1,(unsigned char) i+1);
-    if (i < 9)
-        return left_multiply_by_T(1, i - 3,(unsigned char) i+1);
-    if (i < 12)
-        return left_multiply_by_T(2, i - 6,(unsigned char) i+1);
-    if (i < 14)
-        return left_multiply_by_T(3, i - 8,(unsigned char) i+1);
-    return left_multiply_by_T(4, 5,(unsigned char) i+1);
+    SO6 prod = *this;
+    switch (i) {
+        case 0: left_multiply_by_T<0>(prod); break;
+        case 1: left_multiply_by_T<1>(prod); break;
+        case 2: left_multiply_by_T<2>(prod); break;
+        case 3: left_multiply_by_T<3>(prod); break;
+        case 4: left_multiply_by_T<4>(prod); break;
+        case 5: left_multiply_by_T<5>(prod); break;
+        case 6: left_multiply_by_T<6>(prod); break;
+        case 7: left_multiply_by_T<7>(prod); break;
+        case 8: left_multiply_by_T<8>(prod); break;
+        case 9: left_multiply_by_T<9>(prod); break;
+        case 10: left_multiply_by_T<10>(prod); break;
+        case 11: left_multiply_by_T<11>(prod); break;
+        case 12: left_multiply_by_T<12>(prod); break;
+        case 13: left_multiply_by_T<13>(prod); break;
+        default: left_multiply_by_T<14>(prod); break;
+    }
+    return prod;
 }
 
 
@@ -454,12 +349,87 @@ void SO6::update_history(const unsigned char &p) {
 //     });
 // }
 
-void SO6::lexicographic_order() {
-    // Sort the indices based on the lexicographical order of the corresponding elements in arr
-    for(uint8_t i = 0; i < 6; i++) lex_order[i] = i;
-    std::sort(lex_order, lex_order+6, [this](int i, int j) {
-        return lexicographical_less(i, j);
-    });
+/**
+ * @brief Computes the canonical view of this matrix in Col.
+ *
+ * Rows are read in physical order and columns are sorted by column_key, which normalizes the sign of each column. The
+ * view is therefore the least one over signed permutations of the columns only, so two matrices get the same view
+ * exactly when M' = M Q for a signed permutation Q. Rows are never permuted: the search multiplies on the left
+ * (T M and G S), which commutes with a column quotient since G (M Q) = (G M) Q, but not with any row quotient.
+ */
+void SO6::canonical_form()
+{
+    sort_columns();
+}
+
+/**
+ * @brief Repairs the canonical view after rows row1 and row2 were changed by a T multiplication.
+ *
+ * A column that is zero in both rows is left unchanged by the T step, so its key is still in key, in canonical order.
+ * Only the other columns are keyed and sorted, then merged with the unchanged ones. The result is the same view as
+ * canonical_form(), provided key and Col held the canonical view before the T step.
+ * @param row1 first row modified by the T multiplication
+ * @param row2 second row modified by the T multiplication
+ */
+void SO6::canonical_form(const int &row1, const int &row2)
+{
+    const uint8_t rows = (1 << row1) | (1 << row2);
+    __uint128_t kept[6], changed[6];
+    uint8_t kept_col[6], changed_col[6];
+    int n_kept = 0, n_changed = 0;
+    for (int pos = 0; pos < 6; pos++) {
+        const uint8_t col = Col[pos];
+        if (nonzero_mask(col) & rows) {
+            changed[n_changed] = column_key(col);
+            changed_col[n_changed++] = col;
+        } else {
+            // The final canonical column is not stored in key
+            kept[n_kept] = pos < 5 ? (__uint128_t) key[2 * pos] << 64 | key[2 * pos + 1] : column_key(col);
+            kept_col[n_kept++] = col;
+        }
+    }
+    if (n_kept == 0) {
+        sort_columns();
+        return;
+    }
+
+    // Insertion sort of the few changed columns, then merge with the kept ones, which are already in order
+    for (int i = 1; i < n_changed; i++) {
+        const __uint128_t k = changed[i];
+        const uint8_t c = changed_col[i];
+        int j = i;
+        for (; j > 0 && k < changed[j-1]; j--) {
+            changed[j] = changed[j-1];
+            changed_col[j] = changed_col[j-1];
+        }
+        changed[j] = k;
+        changed_col[j] = c;
+    }
+    __uint128_t k[6];
+    for (int pos = 0, i = 0, j = 0; pos < 6; pos++) {
+        if (j == n_changed || (i < n_kept && kept[i] <= changed[j])) {
+            k[pos] = kept[i];
+            Col[pos] = kept_col[i++];
+        } else {
+            k[pos] = changed[j];
+            Col[pos] = changed_col[j++];
+        }
+    }
+    store_key(k);
+}
+
+/**
+ * @brief Orders Col by column_key with the sorting network and stores the keys of canonical columns 0 to 4 in key.
+ */
+void SO6::sort_columns()
+{
+    __uint128_t k[6];
+    for (uint8_t c = 0; c < 6; c++) {
+        k[c] = column_key(c);
+        Col[c] = c;
+    }
+    sort6(k, Col);
+    store_key(k);
 }
 
 std::string SO6::name()
@@ -475,17 +445,15 @@ SO6 SO6::reconstruct() {
         if(i>15) ret = ret.left_multiply_by_T((i>>4)-1);
     }
     ret.hist = hist;
-    ret.lexicographic_order();
     return ret;
 }
 
-SO6 SO6::reconstruct(const std::string name) {
+SO6 SO6::reconstruct(const std::string &name) {
     SO6 ret = SO6::identity();
     for(unsigned char i : name) {
         ret = ret.left_multiply_by_T((i & 15) -1);
         if(i>15) ret = ret.left_multiply_by_T((i>>4)-1);
     }
-    ret.lexicographic_order();
     return ret;
 }
 
@@ -501,6 +469,13 @@ std::string SO6::name_as_num(const std::string name) {
 }
 
 std::string SO6::circuit_string() {
+    return circuit_string(hist);
+}
+
+/**
+ * @brief Circuit string of a gate history, two T indices per byte.
+ */
+std::string SO6::circuit_string(const std::vector<unsigned char> &hist) {
     std::string ret;
     for (unsigned char byte : hist) {
         int lower = (byte & 15) - 1;  // Lower 4 bits
@@ -554,49 +529,64 @@ SO6 SO6::reconstruct_from_circuit_string(const std::string& input) {
 
 bool SO6::operator<(const SO6 &other) const
 {
-    for (int col = 0; col < 5; ++col)
-    { // There is no need to check the final column due to constraints
-        switch (lexicographical_compare((*this)[lex_order[col]], other[other.lex_order[col]])) {
-            case -1:
-                return true;
-            case 1:
-                return false;
-        }
+    for (int w = 0; w < key_words; w++) {
+        if (key[w] != other.key[w]) return key[w] < other.key[w];
     }
     return false;
 }
 
-const z2_int SO6::getLDE() const
+/**
+ * @brief Residue pattern of this, read off the maintained residue bits.
+ * @return the pattern, with the history of this
+ */
+pattern SO6::to_pattern() const
+{
+    pattern ret = residue_pattern(residue);
+    ret.hist = hist;
+    return ret;
+}
+
+/**
+ * @brief Residue pattern of bit-packed residues, in the layout of residue.
+ * @return the pattern, without history
+ */
+pattern SO6::residue_pattern(const uint64_t *residues)
 {
-    z2_int ret;
-    for (int i = 0; i < 6; i++)
+    pattern ret;
+    for (int col = 0; col < 6; col++)
     {
-        for (int j = 0; j < 6; j++)
+        for (int row = 0; row < 6; row++)
         {
-            ret = std::max(ret, (*this)[i][j].exponent);
+            const int i = col * 6 + row;
+            ret.arr[col][row].first = residues[0] >> i & 1;
+            ret.arr[col][row].second = residues[1] >> i & 1;
         }
     }
+    ret.lexicographic_order();
     return ret;
 }
 
-pattern SO6::to_pattern() const
+/**
+ * @brief Residue pattern of a column-major matrix of entries, without history.
+ * @param m the 36 entries, indexed as arr
+ * @param lde the largest exponent among them
+ */
+template <typename Int>
+pattern SO6::residue_pattern(const basic_Z2<Int> *m, const int &lde)
 {
     pattern ret;
-    ret.hist.reserve(hist.size());
-    ret.hist = hist;
-
-    const int8_t& lde = getLDE();
     for (int col = 0; col < 6; col++)
     {
         for (int row = 0; row < 6; row++)
         {
-            if (arr[row + (col<<2 + col<<1)].exponent < lde - 1 || arr[row + (col<<2 + col<<1)].intPart==0) {
+            const basic_Z2<Int> &z = m[col * 6 + row];
+            if (z.exponent < lde - 1 || z.intPart==0) {
                 continue;
             }
-            if (arr[row + (col<<2 + col<<1)].exponent == lde)
+            if (z.exponent == lde)
             {
                 ret.arr[col][row].first = 1;
-                ret.arr[col][row].second = arr[row + (col<<2 + col<<1)].sqrt2Part % 2;
+                ret.arr[col][row].second = z.sqrt2Part % 2;
                 continue;
             }
             ret.arr[col][row].second = 1;
@@ -606,23 +596,49 @@ pattern SO6::to_pattern() const
     return ret;
 }
 
-
-/** overloads == method to check equality of SO6 matrices
- *  @param other reference to SO6 to be checked against
- *  @return whether or not (*this) and other are equivalent
+/**
+ * @brief Residue pattern of this * other with entries of type basic_Z2<Int>, for products whose LDE is beyond what
+ *        the stored entries hold. Same arithmetic as operator*, widened.
+ * @return the pattern, with the history of this * other
  */
-bool SO6::operator==(SO6 &other)
+template <typename Int>
+pattern SO6::product_pattern(const SO6 &other) const
 {
-    for(int col = 0; col < 5; col ++) {
-        if(lexicographical_compare((*this)[col],other[col])) return false;
+    basic_Z2<Int> prod[36], left[36];
+    for (int i = 0; i < 36; i++) left[i] = basic_Z2<Int>(arr[i]);
+
+    for (int col = 0; col < 6; ++col)
+    {
+        for (int k = 0; k < 6; ++k)
+        {
+            const basic_Z2<Int> scalar(other[col][k]);
+            if (scalar.intPart == 0) continue;
+            basic_Z2<Int> term[6];
+            basic_Z2<Int>::multiply(term, left + get_index(0, k), scalar, 6);
+            basic_Z2<Int>::add(prod + get_index(0, col), term, 6);
+        }
     }
-    return true;
+    int lde = 0;
+    for (int i = 0; i < 36; i++) lde = std::max<int>(lde, prod[i].exponent);
+    pattern ret = residue_pattern(prod, lde);
+    ret.hist.reserve(hist.size() + other.hist.size());
+    std::copy(other.hist.begin(), other.hist.end(), std::back_inserter(ret.hist));
+    std::copy(hist.begin(), hist.end(), std::back_inserter(ret.hist));
+    return ret;
 }
 
+template pattern SO6::product_pattern<int16_t>(const SO6 &) const;
+template pattern SO6::product_pattern<int32_t>(const SO6 &) const;
+
+
+/** overloads == method to check equality of SO6 matrices
+ *  @param other reference to SO6 to be checked against
+ *  @return whether or not the canonical views of (*this) and other agree
+ */
 bool SO6::operator==(const SO6 &other) const
 {
-    for(int col = 0; col < 5; col ++) {
-        if(lexicographical_compare((*this)[col],other[col])) return false;
+    for (int w = 0; w < key_words; w++) {
+        if (key[w] != other.key[w]) return false;
     }
     return true;
 }
@@ -667,14 +683,17 @@ std::ostream &operator<<(std::ostream &os, const SO6 &m) {
     return os;
 }
 
-void SO6::unpermuted_print() {
+/**
+ * @brief Prints the matrix as stored, ignoring Row and Col.
+ */
+void SO6::unpermuted_print() const {
     int maxWidth = 0;
 
     // Find the maximum width of the elements
     for (int row = 0; row < 6; row++) {
         for (int col = 0; col < 6; col++) {
             std::stringstream ss;
-            ss << this[col][row];
+            ss << (*this)[col][row];
             maxWidth = std::max(maxWidth, static_cast<int>(ss.str().length()));
         }
     }
@@ -688,9 +707,26 @@ void SO6::unpermuted_print() {
 
         std::cout << leftBorder << "\t";
         for (int col = 0; col < 6; col++) {
-            std::cout << std::setw(width) << this[col][row];
+            std::cout << std::setw(width) << (*this)[col][row];
         }
         std::cout << "\t" << rightBorder << "\n";
     }
     std::cout << "\n";
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Prints arr in memory order, one physical column per line, followed by Row and Col.
+ */
+void SO6::physical_print() const {
+    std::cout << "\n";
+    for (int col = 0; col < 6; col++) {
+        std::cout << "col " << col << ":";
+        for (int row = 0; row < 6; row++) std::cout << std::setw(10) << arr[get_index(row, col)];
+        std::cout << "\n";
+    }
+    std::cout << "Row:";
+    for (int k = 0; k < 6; k++) std::cout << " " << (int) Row[k];
+    std::cout << "\nCol:";
+    for (int k = 0; k < 6; k++) std::cout << " " << (int) Col[k];
+    std::cout << "\n\n";
+}
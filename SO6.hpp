@@ -3,11 +3,16 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <optional>
 #include <compare>
 #include <concepts>
 #include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
 #include "Z2.hpp"
+#include "Z2Table.hpp"
 #include "pattern.hpp"
 
 class pattern;
@@ -19,7 +24,10 @@ class SO6{
         SO6(pattern &); //initializes matrix according to a pattern
         SO6 operator*(const SO6&) const; //mutliplication
         SO6 operator*(const pattern &) const;
+        template <typename Int> pattern product_pattern(const SO6 &) const;
         bool operator<(const SO6 &) const;
+        bool operator==(const SO6 &) const;
+        bool operator!=(const SO6 &) const;
 
         inline int get_index(const int &row, const int &col) const {return (col<<2) + (col<<1) + row;}
         Z2* operator[](const int &col) {return arr + get_index(0,col);}  // Return the array element needed.
@@ -31,13 +39,20 @@ class SO6{
         friend std::ostream& operator<<(std::ostream&,const SO6&); //display
 
         SO6 left_multiply_by_circuit(std::vector<unsigned char> &);
+        SO6 left_multiply_by_T(const int &, const int &, const unsigned char &) const;
         SO6 left_multiply_by_T_transpose(const int &);        
 
-        const z2_int getLDE() const;
+        /// @brief LDE of the matrix, maintained by every operation that writes entries.
+        inline z2_int getLDE() const { return lde_bits >> 24; }
+        /// @brief LDE of physical column col.
+        inline z2_int column_lde(const int &col) const { return (lde_bits >> (col << 2)) & 15; }
         pattern to_pattern() const;
+        static pattern residue_pattern(const uint64_t *);
+        template <typename Int> static pattern residue_pattern(const basic_Z2<Int> *, const int &);
         SO6 transpose();
         std::string name(); 
         std::string circuit_string(); 
+        static std::string circuit_string(const std::vector<unsigned char> &);
         static SO6 reconstruct_from_circuit_string(const std::string& );        
         
         void update_history(const unsigned char &); 
@@ -46,6 +61,8 @@ class SO6{
         void unpermuted_print() const;
         void unpermuted_print(const std::bitset<6> &) const;
         void canonical_form();
+        void canonical_form(const int &, const int &);
+        void sort_columns();
         void canonical_form_test();
 
         int get_pivot_column(std::bitset<6>&, std::unordered_map<std::bitset<6>,int>&);
@@ -55,7 +72,7 @@ class SO6{
         // SO6 reconstruct(const std::string &);
         static std::string name_as_num(const std::string);
         
-        std::strong_ordering lex_order(const int &, const int &, const int &) const;
+        std::strong_ordering lex_order(const int &, const SO6 &, const int &) const;
         
         template <bool first_is_negative, bool second_is_negative> static bool lex_comparator(const Z2 &, const Z2 &);
 
@@ -63,13 +80,216 @@ class SO6{
             SO6 I;
             for(int k =0; k<6; k++) {
                 I.arr[(k<<2) + (k<<1) + k] = 1;
-                I.row_frequency[k][Z2(1,0,0)] = 1;
-                I.row_frequency[k][Z2(0,0,0)] = 5;
             }
+            I.update_residue();
+            I.canonical_form();
             return I;
         }
+
+        /**
+         * @brief Order-preserving 21-bit code of an entry in the order used by lex_order: larger values come first,
+         *        so positive entries precede zero, which precedes negative ones. The exponent gets 5 bits, which covers
+         *        every T count the 8-bit entries can represent.
+         * @param z the entry
+         * @param mask all ones to encode -z instead, zero otherwise
+         */
+        static inline uint32_t entry_code(const Z2 &z, const z2_int mask = 0) {
+            const z2_int a = (z.intPart ^ mask) - mask, b = (z.sqrt2Part ^ mask) - mask;
+            return (uint32_t) (uint8_t) (127 - a) << 13 | (uint32_t) (uint8_t) (127 - b) << 5 | ((uint32_t) (31 - z.exponent) & 31);
+        }
+
+        /**
+         * @brief Key of a physical column in the canonical view: the entry_codes of its entries in physical row order,
+         *        first row most significant, with the column negated if its first nonzero entry is negative. Comparing
+         *        keys is lex_order.
+         */
+        inline __uint128_t column_key(const int &col) const {
+            const Z2 *c = arr + get_index(0, col);
+            z2_int lead = 0;
+            for (int row = 0; row < 6 && !lead; row++) lead = c[row].intPart;
+            const z2_int mask = lead >> 7;
+            __uint128_t k = 0;
+            for (int row = 0; row < 6; row++) k = k << 21 | entry_code(c[row], mask);
+            return k;
+        }
+
+        /**
+         * @brief Branch-free compare-exchange of keys i and j, carrying the column indices along.
+         */
+        template <int i, int j>
+        static inline void compare_exchange(__uint128_t *k, uint8_t *c) {
+            const bool swap = k[j] < k[i];
+            const __uint128_t lo = swap ? k[j] : k[i], hi = swap ? k[i] : k[j];
+            const uint8_t clo = swap ? c[j] : c[i], chi = swap ? c[i] : c[j];
+            k[i] = lo; k[j] = hi;
+            c[i] = clo; c[j] = chi;
+        }
+
+        /// @brief Optimal sorting network for six inputs: 12 comparators in 5 layers.
+        static constexpr uint8_t network6[12][2] = {{0,5},{1,3},{2,4}, {1,2},{3,4}, {0,3},{2,5}, {0,1},{2,3},{4,5}, {1,2},{3,4}};
+
+        template <std::size_t... I>
+        static inline void sort6(__uint128_t *k, uint8_t *c, std::index_sequence<I...>) {
+            (compare_exchange<network6[I][0], network6[I][1]>(k, c), ...);
+        }
+
+        /**
+         * @brief Sorts six column keys, and the columns with them, with network6. Equal keys are equal columns, so stability is not needed.
+         */
+        static inline void sort6(__uint128_t *k, uint8_t *c) {
+            sort6(k, c, std::make_index_sequence<12>());
+        }
+
+        /**
+         * @brief Packs the sorted column keys of canonical columns 0 to 4 into key, two words per column. The final column
+         * is fixed by the other five, so comparing these words compares the whole canonical view.
+         */
+        inline void store_key(const __uint128_t *k) {
+            for (int col = 0; col < 5; col++) {
+                key[2 * col] = (uint64_t) (k[col] >> 64);
+                key[2 * col + 1] = (uint64_t) k[col];
+            }
+        }
+
+        /// @brief Hash of the sort key, consistent with operator==.
+        inline size_t hash() const {
+            uint64_t h = key[0];
+            for (int w = 1; w < key_words; w++) h = (h ^ (h >> 31)) * 0x9E3779B97F4A7C15ull + key[w];
+            return h ^ (h >> 29);
+        }
+
+        /**
+         * @brief Recomputes the LDE of physical column col from its entries. Stored entries have LDE at most Z2::max_lde,
+         *        so a nibble holds it.
+         */
+        inline void update_column_lde(const int &col) {
+            int m = 0;
+            for (int row = 0; row < 6; row++) m = std::max<int>(m, arr[get_index(row, col)].exponent);
+            lde_bits = (lde_bits & ~(15u << (col << 2))) | (uint32_t) (m & 15) << (col << 2);
+        }
+
+        /**
+         * @brief Updates the LDE of physical column col after a T multiplication rewrote rows row1 and row2, whose larger
+         *        exponent was old before it. If the column LDE came from another row, that row is unchanged and only rows
+         *        row1 and row2 are read. Otherwise the column is rescanned.
+         */
+        inline void update_column_lde(const int &row1, const int &row2, const int &col, const int &old) {
+            const int lde = column_lde(col);
+            if (lde <= old) {
+                update_column_lde(col);
+                return;
+            }
+            const int m = std::max<int>({lde, arr[get_index(row1, col)].exponent, arr[get_index(row2, col)].exponent});
+            lde_bits = (lde_bits & ~(15u << (col << 2))) | (uint32_t) (m & 15) << (col << 2);
+        }
+
+        /// @brief Sets the LDE of the matrix from the column LDEs.
+        inline void update_matrix_lde() {
+            uint32_t m = 0;
+            for (int col = 0; col < 6; col++) m = std::max(m, (lde_bits >> (col << 2)) & 15);
+            lde_bits = (lde_bits & 0xFFFFFFu) | m << 24;
+        }
+
+        /// @brief Recomputes every LDE, needed after writing arr directly.
+        inline void update_lde() {
+            for (int col = 0; col < 6; col++) update_column_lde(col);
+            update_matrix_lde();
+        }
+
+        /**
+         * @brief Sets the residue bits of the entry at physical index i for matrix LDE lde: bit i of residue[0] if it is
+         *        nonzero with exponent lde, bit i of residue[1] if then its √2 part is odd or if it is nonzero with exponent
+         *        lde - 1. These are the first and second halves of the pair to_pattern gives the entry.
+         */
+        inline void update_residue(const int &i, const int &lde) {
+            const Z2 &z = arr[i];
+            const bool top = z.intPart != 0 && z.exponent == lde;
+            const bool second = top ? (z.sqrt2Part & 1) : (z.intPart != 0 && z.exponent == lde - 1);
+            residue[0] = (residue[0] & ~(1ull << i)) | (uint64_t) top << i;
+            residue[1] = (residue[1] & ~(1ull << i)) | (uint64_t) second << i;
+        }
+
+        /// @brief Recomputes every residue bit, needed after writing arr directly. Call after update_lde.
+        inline void update_residue() {
+            for (int i = 0; i < 36; i++) update_residue(i, getLDE());
+        }
+
+        /**
+         * @brief Updates the residue bits after a T multiplication changed rows row1 and row2 and the LDE went from
+         *        old_lde to getLDE(). The LDE moves by at most one. If it stays, the other rows keep their bits. If it
+         *        rises, their entries at old_lde drop to the second half and those at old_lde - 1 vanish from the
+         *        pattern. If it falls, entries two below the old LDE come in, and those are not tracked: recompute.
+         */
+        inline void update_residue(const int &row1, const int &row2, const int &old_lde) {
+            const int lde = getLDE();
+            if (lde < old_lde) {
+                update_residue();
+                return;
+            }
+            if (lde > old_lde) {
+                residue[1] = residue[0];
+                residue[0] = 0;
+            }
+            for (int col = 0; col < 6; col++) {
+                update_residue(get_index(row1, col), lde);
+                update_residue(get_index(row2, col), lde);
+            }
+        }
+
+        /**
+         * @brief Key of the bucket a matrix is multiplied in: its residues and LDE. By product_residues, every product of
+         *        two buckets whose top residues multiply to nonzero has one pattern, and one LDE.
+         */
+        inline __uint128_t bucket_key() const { return (__uint128_t) residue[1] << 64 | (uint64_t) getLDE() << 36 | residue[0]; }
+
+        /// @brief Product over GF(2) of two 6x6 bit matrices in the layout of residue.
+        static inline uint64_t residue_product(const uint64_t &g, const uint64_t &s) {
+            uint64_t ret = 0;
+            for (int col = 0; col < 6; col++) {
+                uint64_t column = 0;
+                for (unsigned bits = s >> (6 * col) & 63; bits; bits &= bits - 1) column ^= g >> (6 * __builtin_ctz(bits)) & 63;
+                ret |= column << (6 * col);
+            }
+            return ret;
+        }
+
+        /**
+         * @brief Residues of G*S from those of G and S. Scaled to the denominator √2^LDE, an entry's numerator modulo 2
+         *        is first + √2 second of its residue bits, and (a + √2 b)(c + √2 d) ≡ ac + √2 (ad + bc) modulo 2. So the
+         *        numerator of G*S at exponent LDE(G) + LDE(S) is known modulo 2. If its first part is nonzero that is the
+         *        LDE of G*S and these are its residues; otherwise the LDE drops and they are not known.
+         * @return false if the residues of G*S are not determined
+         */
+        static inline bool product_residues(const SO6 &G, const SO6 &S, uint64_t *residues) {
+            residues[0] = residue_product(G.residue[0], S.residue[0]);
+            residues[1] = residue_product(G.residue[0], S.residue[1]) ^ residue_product(G.residue[1], S.residue[0]);
+            return residues[0] != 0;
+        }
+
+        /// @brief Bit r is set if entry (r, col) is nonzero.
+        inline uint8_t nonzero_mask(const int &col) const {
+            uint8_t mask = 0;
+            for (int row = 0; row < 6; row++) mask |= (arr[get_index(row, col)].intPart != 0) << row;
+            return mask;
+        }
+
+        /**
+         * @brief Table-driven T step on one column when both entries and both results are interned in Z2Table.
+         * @return false if the column has to be done with Z2 arithmetic, in which case it is left untouched
+         */
+        inline bool interned_t_step(const int &row1, const int &row2, const int &col) {
+            Z2 &x = arr[get_index(row1, col)], &y = arr[get_index(row2, col)];
+            uint8_t ox = Z2Table::ordinal(x), oy = Z2Table::ordinal(y);
+            if (ox == Z2Table::none || oy == Z2Table::none || !Z2Table::t_step(ox, oy)) return false;
+            x = Z2Table::entry(ox);
+            y = Z2Table::entry(oy);
+            return true;
+        }
         uint8_t Col[6] = {0,1,2,3,4,5};
         uint8_t Row[6] = {0,1,2,3,4,5};
+        uint32_t lde_bits = 0;  // LDE of physical column c in bits 4c..4c+3, LDE of the matrix in bits 24..31. Fits the padding after Row.
+                                // A T step reads only its two rows of a column unless the column LDE came from them, then
+                                // takes the matrix LDE as the largest of the six.
 
         
         
@@ -88,7 +308,7 @@ class SO6{
         bool submatrix_lex_less(std::vector<int> &, std::vector<int> &, int);
 
         template<int i> requires(i >= 0 && i < 15) 
-        static SO6 left_multiply_by_T(SO6 &S) {
+        static SO6& left_multiply_by_T(SO6 &S) {
             int row1, row2;
             unsigned char p;
 
@@ -112,43 +332,44 @@ class SO6{
 
             // Now we only have one method that uses the calculated row1, row2, and p
             // #pragma unroll
+            const int old_lde = S.getLDE();
             for (int col = 0; col < 6; col++)
             {
-                // To track the column sum, begin by decreasing the size by the elements that will be modified
-                if (S.row_frequency[row1][S.get_element(row1, col).abs()] == 1) {
-                    S.row_frequency[row1].erase(S.get_element(row1, col).abs());
-                } else {
-                    S.row_frequency[row1][S.get_element(row1, col).abs()]--;
-                }
-
-                if (S.row_frequency[row2][S.get_element(row2, col).abs()] == 1) {
-                    S.row_frequency[row2].erase(S.get_element(row2, col).abs());
-                } else {
-                    S.row_frequency[row2][S.get_element(row2, col).abs()]--;
+                const int old_rows_lde = std::max<int>(S.get_element(row1, col).exponent, S.get_element(row2, col).exponent);
+                if (!S.interned_t_step(row1, row2, col)) {
+                    Z2 tmp1 = S.get_element(row1, col);
+                    Z2 tmp2 = S.get_element(row2, col);
+                    S.get_element(row1, col) += tmp2;
+                    S.get_element(row2, col) -= tmp1;
+                    S.get_element(row1, col).increaseDE();
+                    S.get_element(row2, col).increaseDE();
                 }
-
-                // Update elements
-                Z2 tmp1 = S.get_element(row1, col);
-                Z2 tmp2 = S.get_element(row2, col);
-                S.get_element(row1, col) += tmp2;
-                S.get_element(row2, col) -= tmp1;
-                S.get_element(row1, col).increaseDE();
-                S.get_element(row2, col).increaseDE();
-
-                // Update frequencies
-                S.row_frequency[row1][S.get_element(row1, col).abs()]++;
-                S.row_frequency[row2][S.get_element(row2, col).abs()]++;
+                S.update_column_lde(row1, row2, col, old_rows_lde);
             }
+            S.update_matrix_lde();
+            S.update_residue(row1, row2, old_lde);
 
-            S.canonical_form();
+            S.canonical_form(row1, row2);
             S.update_history(p);
             return S;
         }
    
         void sort_physical_array();
         void physical_print() const;
+
+        /// @brief Estimated heap bytes owned by this matrix outside of its own storage, used by the memory report.
+        size_t heap_footprint() const {
+            auto chunk = [](size_t bytes) -> size_t { return bytes ? std::max<size_t>(32, (bytes + 8 + 15) & ~size_t(15)) : 0; };
+            size_t ret = chunk(hist.capacity());
+            ret += chunk(ecs.capacity() * sizeof(std::vector<int>));
+            for (const std::vector<int> &ec : ecs) ret += chunk(ec.capacity() * sizeof(int));
+            return ret;
+        }
+
         std::vector<unsigned char> hist;
-        std::map<Z2,int> row_frequency[6];
+        static constexpr int key_words = 10;
+        uint64_t key[key_words] = {};   // column_keys of canonical columns 0 to 4, high word first, set by canonical_form
+        uint64_t residue[2] = {};   // to_pattern bit-packed by physical index, first and second halves, maintained like the LDE
         std::vector<std::vector<int>> ecs;
 
         // Custom iterator class
@@ -226,4 +447,13 @@ class SO6{
         
 };;
 
+namespace std {
+    template <>
+    struct hash<SO6> {
+        size_t operator()(const SO6& S) const {
+            return S.hash();
+        }
+    };
+}
+
 #endif
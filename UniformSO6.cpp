@@ -0,0 +1,122 @@
+#include <algorithm>
+#include "UniformSO6.hpp"
+
+/**
+ * @brief Brings every entry of S to the common denominator √2^k, k the LDE of S. An entry (a + b√2)/√2^e is multiplied by
+ *        √2^(k-e): an even power shifts both parts, an odd one also swaps them since √2(a + b√2) = 2b + a√2.
+ */
+UniformSO6::UniformSO6(const SO6 &S)
+{
+    k = S.getLDE();
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            const Z2 &z = S.arr[col * 6 + row];
+            if (z.intPart == 0) continue;
+            const int d = k - z.exponent, h = d >> 1;
+            A[col][row] = (d & 1) ? z.sqrt2Part << (h + 1) : z.intPart << h;
+            B[col][row] = (d & 1) ? z.intPart << h : z.sqrt2Part << h;
+            col_mask[col] |= 1 << row;
+            row_mask[row] |= 1 << col;
+        }
+    }
+}
+
+/**
+ * @brief Columns of the numerator of this * other. Column col of the product is the sum over the nonzero entries (j, col)
+ *        of other of column j of this scaled by that entry, four integer axpys on whole columns per entry. The nonzero
+ *        entries are visited through col_mask with tzcnt, so zeros cost neither work nor mispredicted branches.
+ *        A signed permutation on either side needs no multiplications: on the right it selects and negates columns of
+ *        this, on the left it permutes and negates the rows of other.
+ */
+void UniformSO6::product_columns(const UniformSO6 &other, column *PA, column *PB) const
+{
+    if (other.is_signed_permutation()) {
+        for (int col = 0; col < 6; col++) {
+            const int j = __builtin_ctz(other.col_mask[col]);
+            const int16_t sign = other.A[col][j];
+            PA[col] = A[j] * sign;
+            PB[col] = B[j] * sign;
+        }
+        return;
+    }
+    if (is_signed_permutation()) {
+        // Row r of the product is row perm[r] of other times sign[r]
+        column perm = {0, 1, 2, 3, 4, 5, 6, 7}, sign = {};
+        for (int r = 0; r < 6; r++) {
+            const int j = __builtin_ctz(row_mask[r]);
+            perm[r] = j;
+            sign[r] = A[j][r];
+        }
+        for (int col = 0; col < 6; col++) {
+            PA[col] = __builtin_shuffle(other.A[col], perm) * sign;
+            PB[col] = __builtin_shuffle(other.B[col], perm) * sign;
+        }
+        return;
+    }
+    for (int col = 0; col < 6; col++) {
+        column pa = {}, pb = {};
+        for (unsigned bits = other.col_mask[col]; bits; bits &= bits - 1) {
+            const int j = __builtin_ctz(bits);
+            const int16_t a = other.A[col][j], b = other.B[col][j];
+            pa += A[j] * a + ((B[j] * b) << 1);
+            pb += A[j] * b + B[j] * a;
+        }
+        PA[col] = pa;
+        PB[col] = pb;
+    }
+}
+
+/**
+ * @brief Residue pattern of this * other.
+ * @return the pattern, without history
+ */
+pattern UniformSO6::product_pattern(const UniformSO6 &other) const
+{
+    uint64_t residues[2];
+    product_residues(other, residues);
+    return SO6::residue_pattern(residues);
+}
+
+/**
+ * @brief Residues of this * other in the layout of SO6::residue, which PatternIndex::key reads without a pattern.
+ */
+void UniformSO6::product_residues(const UniformSO6 &other, uint64_t *residues) const
+{
+    column PA[6], PB[6];
+    product_columns(other, PA, PB);
+    residue_bits(PA, PB, residues);
+}
+
+/**
+ * @brief Residues of a product numerator. One pass finds the reduced exponent of each entry, min(2·v(a), 2·v(b) + 1)
+ *        below the common one with v counting trailing zeros, and the residue bits of to_pattern.
+ */
+void UniformSO6::residue_bits(const column *PA, const column *PB, uint64_t *residues)
+{
+    // Valuation of each entry; zero entries get the largest one so they never set the LDE
+    int8_t v[36];
+    int lowest = 64;
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            const unsigned a = PA[col][row], b = PB[col][row];
+            v[col * 6 + row] = std::min(2 * __builtin_ctz(a | 1u << 31), 2 * __builtin_ctz(b | 1u << 31) + 1);
+            lowest = std::min<int>(lowest, v[col * 6 + row]);
+        }
+    }
+
+    // The entries of largest reduced exponent have the smallest valuation
+    residues[0] = residues[1] = 0;
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            const int i = col * 6 + row, w = v[i];
+            if (w > lowest + 1 || w >= 62) continue;
+            if (w == lowest) {
+                const int reduced_b = (w & 1) ? PA[col][row] >> ((w >> 1) + 1) : PB[col][row] >> (w >> 1);
+                residues[0] |= 1ull << i;
+                residues[1] |= (uint64_t) (reduced_b & 1) << i;
+                continue;
+            }
+            residues[1] |= 1ull << i;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef UNIFORMSO6_HPP
+#define UNIFORMSO6_HPP
+
+#include <cstdint>
+#include "SO6.hpp"
+#include "pattern.hpp"
+
+/**
+ * @file UniformSO6.hpp
+ * @brief SO6 with one common denominator, S = (A + √2 B)/√2^k, for fast products.
+ *
+ * With a common denominator a product is integer matrix arithmetic, (A + √2 B)(C + √2 D) = (AC + 2BD) + √2 (AD + BC)
+ * over √2^(k + l), without aligning exponents entry by entry. Columns are padded to eight int16 lanes so that one column
+ * is one SIMD register. Every partial sum of AC, BD, AD and BC is bounded by √2^(k + l): it is a combination of dot
+ * products of unit vectors in the two real embeddings of Z[1/√2]. So int16 holds every product with k + l ≤ max_lde.
+ */
+class UniformSO6 {
+    public:
+        typedef int16_t column __attribute__((vector_size(16)));
+        static constexpr int max_lde = 28;
+
+        UniformSO6() = default;
+        explicit UniformSO6(const SO6 &);
+
+        pattern product_pattern(const UniformSO6 &) const;
+        void product_residues(const UniformSO6 &, uint64_t *) const;
+
+        /// @brief True if the matrix is a signed permutation, the only orthogonal matrices with LDE 0.
+        inline bool is_signed_permutation() const { return k == 0; }
+
+        column A[6] = {};   // integer parts, column-major like SO6::arr, lanes 6 and 7 unused
+        column B[6] = {};   // √2 parts
+        int k = 0;          // common denominator exponent, the LDE of the matrix
+        uint8_t col_mask[6] = {};   // bit r of col_mask[c] is set if entry (r, c) is nonzero
+        uint8_t row_mask[6] = {};   // bit c of row_mask[r] is set if entry (r, c) is nonzero
+
+    private:
+        void product_columns(const UniformSO6 &, column *, column *) const;
+        static void residue_bits(const column *, const column *, uint64_t *);
+};
+
+#endif // UNIFORMSO6_HPP
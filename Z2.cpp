@@ -9,7 +9,8 @@
  * Initializes a Z2 object to represent the number 0.
  * This is achieved by setting all components of the number (integer part, sqrt(2) part, and log base √2 of the denominator) to 0.
  */
-Z2::Z2()
+template <typename Int>
+basic_Z2<Int>::basic_Z2()
 {
     intPart = 0;
     sqrt2Part = 0;
@@ -24,7 +25,8 @@ Z2::Z2()
  * @param c The exponent c in the denominator, representing the power of √2. Affects the scaling of the number.
  * This constructor allows for the creation of a Z2 number with specific components, enabling the representation of a wide range of values.
  */
-Z2::Z2(const z2_int a, const z2_int b, const z2_int c)
+template <typename Int>
+basic_Z2<Int>::basic_Z2(const Int a, const Int b, const Int c)
 {
     intPart = a;
     sqrt2Part = b;
@@ -39,9 +41,10 @@ Z2::Z2(const z2_int a, const z2_int b, const z2_int c)
  * @param other The Z2 object to add to the current object.
  * @return The result of adding the current object and the 'other' object.
  */
-Z2 Z2::operator+(const Z2 &other) const
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::operator+(const basic_Z2 &other) const
 {
-    Z2 tmp = *this;
+    basic_Z2 tmp = *this;
     tmp += other;
     return tmp;
 }
@@ -92,180 +95,132 @@ Z2 Z2::operator+(const Z2 &other) const
 //     return *this;
 // }
 
-Z2& Z2::operator+=(const Z2 &other) {
-    if(other.intPart==0) {
-        return *this;
-    }
-    if(intPart==0) {
-        *this = other;
-        return *this;
-    }
+/**
+ * Multiplies the numerator (a + b√2) by √2^k without branching: an even k shifts both parts, an odd k also swaps them,
+ * since √2(a + b√2) = 2b + a√2.
+ */
+template <typename Wide>
+static inline void scale_numerator(Wide &a, Wide &b, const int k)
+{
+    const int h = k >> 1;
+    const Wide na = (k & 1) ? b << (h + 1) : a << h;
+    const Wide nb = (k & 1) ? a << h : b << h;
+    a = na;
+    b = nb;
+}
 
-    uz2_int exp_diff = std::abs(exponent - other.exponent);       
-
-    if(other.exponent < exponent) {
-        if(exp_diff & 1) {
-            intPart += other.sqrt2Part << ((exp_diff + 1) >> 1);
-            sqrt2Part += other.intPart << (exp_diff >> 1);
-        } else {
-            intPart += other.intPart << (exp_diff >> 1);
-            sqrt2Part += other.sqrt2Part << (exp_diff >> 1);
-            if(!exp_diff) reduce();
-        }
-    } else {
-        if(exp_diff & 1) {
-            std::swap(intPart, sqrt2Part);
-            intPart <<= 1; // multiply intPart by 2
-            exp_diff--; // already multiplied by 2, exp_diff is now even
-        }
-        intPart <<= (exp_diff >> 1);
-        sqrt2Part <<= (exp_diff >> 1);
-        exponent = other.exponent;
-        intPart += other.intPart;
-        sqrt2Part += other.sqrt2Part;
-        exponent = other.exponent;
-        if(!exp_diff) reduce();
-    }
-    return *this;
+/**
+ * Stores the reduced form of (a + b√2)/√2^e without loops or branches. The power of √2 dividing a + b√2 is
+ * min(2·v(a), 2·v(b) + 1) where v counts trailing zeros, so one shift by half of it and a swap when it is odd give the
+ * reduced form. Zero becomes (0,0,0).
+ * @return false if the reduced parts do not fit in Int
+ */
+template <typename Int>
+bool basic_Z2<Int>::assign_reduced(Wide a, Wide b, const int e)
+{
+    const bool zero = (a | b) == 0;
+    const int v = std::min(2 * __builtin_ctzll((uint64_t) a | 1ull << 62), 2 * __builtin_ctzll((uint64_t) b | 1ull << 62) + 1);
+    const int k = zero ? 0 : v;
+    a >>= k >> 1;
+    b >>= k >> 1;
+    const Wide ra = (k & 1) ? b : a;
+    const Wide rb = (k & 1) ? a >> 1 : b;
+    intPart = ra;
+    sqrt2Part = rb;
+    exponent = zero ? 0 : e - k;
+    return (intPart == ra) & (sqrt2Part == rb);
 }
 
-Z2& Z2::abs_add(const Z2 &other) {
-    if(other.intPart==0) {
-        return *this;
-    }
-    if(intPart==0) {
-        if(other.intPart < 0) {
-            intPart = -other.intPart;
-            sqrt2Part = -other.sqrt2Part;
-        } else {
-            *this = other;
-        }
-        return *this;
-    }
+/**
+ * Adds (c + d√2)/√2^f to this. Both operands are scaled to the larger exponent, which needs no case for zero operands
+ * since zero scales to zero, and the sum is reduced.
+ * @return false if the result does not fit in Int
+ */
+template <typename Int>
+bool basic_Z2<Int>::add_parts(Wide c, Wide d, const int f)
+{
+    Wide a = intPart, b = sqrt2Part;
+    const int e = std::max<int>(exponent, f);
+    scale_numerator(a, b, e - exponent);
+    scale_numerator(c, d, e - f);
+    return assign_reduced(a + c, b + d, e);
+}
 
-    // It is now the case that they are both non-zero
-    uz2_int exp_diff = std::abs(exponent - other.exponent);       
-    if(other.intPart < 0) {
-        if(other.exponent < exponent) {
-            if(exp_diff & 1) {
-                intPart -= other.sqrt2Part << ((exp_diff + 1) >> 1);
-                sqrt2Part -= other.intPart << (exp_diff >> 1);
-            } else {
-                intPart -= other.intPart << (exp_diff >> 1);
-                sqrt2Part -= other.sqrt2Part << (exp_diff >> 1);
-                // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-            }
-        } else {
-            if(exp_diff & 1) {
-                std::swap(intPart, sqrt2Part);
-                intPart <<= 1; // multiply intPart by 2
-                exp_diff--; // already multiplied by 2, exp_diff is now even
-            }
-            intPart <<= (exp_diff >> 1);
-            sqrt2Part <<= (exp_diff >> 1);
-            exponent = other.exponent;
-            intPart -= other.intPart;
-            sqrt2Part -= other.sqrt2Part;
-            exponent = other.exponent;
-            // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-        }
-    }
-    if(other.exponent < exponent) {
-        if(exp_diff & 1) {
-            intPart += other.sqrt2Part << ((exp_diff + 1) >> 1);
-            sqrt2Part += other.intPart << (exp_diff >> 1);
-        } else {
-            intPart += other.intPart << (exp_diff >> 1);
-            sqrt2Part += other.sqrt2Part << (exp_diff >> 1);
-            // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-        }
-    } else {
-        if(exp_diff & 1) {
-            std::swap(intPart, sqrt2Part);
-            intPart <<= 1; // multiply intPart by 2
-            exp_diff--; // already multiplied by 2, exp_diff is now even
-        }
-        intPart <<= (exp_diff >> 1);
-        sqrt2Part <<= (exp_diff >> 1);
-        exponent = other.exponent;
-        intPart += other.intPart;
-        sqrt2Part += other.sqrt2Part;
-        exponent = other.exponent;
-    }
-   
+template <typename Int>
+basic_Z2<Int>& basic_Z2<Int>::operator+=(const basic_Z2 &other) {
+    overflow |= !add_parts(other.intPart, other.sqrt2Part, other.exponent);
     return *this;
 }
 
-Z2& Z2::abs_subtract(const Z2 &other) {
-    if(other.intPart==0) {
-        return *this;
-    }
-    if(intPart==0) {
-        if(other.intPart < 0) {
-            *this = other;
-            return *this;
-        } else {
-            intPart = -other.intPart;
-            sqrt2Part = -other.sqrt2Part;
-            exponent = other.exponent;
-        }
-        return *this;
-    }
+/**
+ * Adds |other| to this, where the sign of other is the sign of its intPart.
+ */
+template <typename Int>
+basic_Z2<Int>& basic_Z2<Int>::abs_add(const basic_Z2 &other) {
+    const Wide sign = other.intPart < 0 ? -1 : 1;
+    overflow |= !add_parts(sign * other.intPart, sign * other.sqrt2Part, other.exponent);
+    return *this;
+}
 
-    // It is now the case that they are both non-zero
-    uz2_int exp_diff = std::abs(exponent - other.exponent);       
-    if(other.intPart < 0) {
-        if(other.exponent < exponent) {
-            if(exp_diff & 1) {
-                intPart += other.sqrt2Part << ((exp_diff + 1) >> 1);
-                sqrt2Part += other.intPart << (exp_diff >> 1);
-            } else {
-                intPart += other.intPart << (exp_diff >> 1);
-                sqrt2Part += other.sqrt2Part << (exp_diff >> 1);
-                // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-            }
-        } else {
-            if(exp_diff & 1) {
-                std::swap(intPart, sqrt2Part);
-                intPart <<= 1; // multiply intPart by 2
-                exp_diff--; // already multiplied by 2, exp_diff is now even
-            }
-            intPart <<= (exp_diff >> 1);
-            sqrt2Part <<= (exp_diff >> 1);
-            exponent = other.exponent;
-            intPart += other.intPart;
-            sqrt2Part += other.sqrt2Part;
-            exponent = other.exponent;
-            // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-        }
-    }
-    if(other.exponent < exponent) {
-        if(exp_diff & 1) {
-            intPart -= other.sqrt2Part << ((exp_diff + 1) >> 1);
-            sqrt2Part -= other.intPart << (exp_diff >> 1);
-        } else {
-            intPart -= other.intPart << (exp_diff >> 1);
-            sqrt2Part -= other.sqrt2Part << (exp_diff >> 1);
-            // if(!exp_diff) reduce(); Guaranteed to be odd, do not need to reduce
-        }
-    } else {
-        if(exp_diff & 1) {
-            std::swap(intPart, sqrt2Part);
-            intPart <<= 1; // multiply intPart by 2
-            exp_diff--; // already multiplied by 2, exp_diff is now even
-        }
-        intPart <<= (exp_diff >> 1);
-        sqrt2Part <<= (exp_diff >> 1);
-        exponent = other.exponent;
-        intPart -= other.intPart;
-        sqrt2Part -= other.sqrt2Part;
-        exponent = other.exponent;
-    }
-   
+/**
+ * Subtracts |other| from this, where the sign of other is the sign of its intPart.
+ */
+template <typename Int>
+basic_Z2<Int>& basic_Z2<Int>::abs_subtract(const basic_Z2 &other) {
+    const Wide sign = other.intPart < 0 ? 1 : -1;
+    overflow |= !add_parts(sign * other.intPart, sign * other.sqrt2Part, other.exponent);
     return *this;
 }
 
+/**
+ * Adds n entries of src to dst element-wise, e.g. one column onto another. Each entry uses the branch-free add and
+ * the overflow flag is collected in a register, so the loop has no data-dependent branches and one flag update.
+ */
+template <typename Int>
+void basic_Z2<Int>::add(basic_Z2 *dst, const basic_Z2 *src, const int &n)
+{
+    bool fits = true;
+    for (int i = 0; i < n; i++) fits &= dst[i].add_parts(src[i].intPart, src[i].sqrt2Part, src[i].exponent);
+    overflow |= !fits;
+}
 
+/**
+ * Subtracts n entries of src from dst element-wise.
+ */
+template <typename Int>
+void basic_Z2<Int>::subtract(basic_Z2 *dst, const basic_Z2 *src, const int &n)
+{
+    bool fits = true;
+    for (int i = 0; i < n; i++) fits &= dst[i].add_parts(-(Wide) src[i].intPart, -(Wide) src[i].sqrt2Part, src[i].exponent);
+    overflow |= !fits;
+}
+
+/**
+ * Sets dst[i] = src[i] * s for n entries, e.g. a column scaled by one entry, with one overflow flag update.
+ */
+template <typename Int>
+void basic_Z2<Int>::multiply(basic_Z2 *dst, const basic_Z2 *src, const basic_Z2 &s, const int &n)
+{
+    bool fits = true;
+    for (int i = 0; i < n; i++) fits &= dst[i].assign_product(src[i], s);
+    overflow |= !fits;
+}
+
+/**
+ * Stores x * y. The product of two reduced entries with odd intParts has an odd intPart, so it is reduced unless one
+ * of them is zero, which still gives a zero value.
+ * @return false if the product does not fit in Int
+ */
+template <typename Int>
+bool basic_Z2<Int>::assign_product(const basic_Z2 &x, const basic_Z2 &y)
+{
+    const Wide a = (Wide) x.intPart * y.intPart + ((Wide) x.sqrt2Part * y.sqrt2Part << 1);
+    const Wide b = (Wide) x.intPart * y.sqrt2Part + (Wide) x.sqrt2Part * y.intPart;
+    intPart = a;
+    sqrt2Part = b;
+    exponent = x.exponent + y.exponent;
+    return (intPart == a) & (sqrt2Part == b);
+}
 
 /**
  * Overloads the -= operator for Z2 objects.
@@ -273,8 +228,9 @@ Z2& Z2::abs_subtract(const Z2 &other) {
  * @param other The Z2 object to be subtracted from the current object.
  * @return A reference to the current object after subtraction.
  */
-Z2 &Z2::operator-=(const Z2 &other){
-    *this += -other;
+template <typename Int>
+basic_Z2<Int> &basic_Z2<Int>::operator-=(const basic_Z2 &other){
+    overflow |= !add_parts(-(Wide) other.intPart, -(Wide) other.sqrt2Part, other.exponent);
     return *this;
 }
 
@@ -282,8 +238,9 @@ Z2 &Z2::operator-=(const Z2 &other){
  * Overloads the - operator for negating a Z2 object.
  * @return The negated Z2 object.
  */
-Z2 Z2::operator-() const { 
-    return Z2(-intPart, -sqrt2Part, exponent); 
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::operator-() const { 
+    return basic_Z2(-intPart, -sqrt2Part, exponent); 
 }
 
 
@@ -293,7 +250,8 @@ Z2 Z2::operator-() const {
  * @param other The Z2 object to be subtracted from the current object.
  * @return The result of the subtraction.
  */
-Z2 Z2::operator-(Z2 &other) { return -other + *this; }
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::operator-(basic_Z2 &other) { return -other + *this; }
 
 // /**
 //  * Overloads the * operator for Z2
@@ -315,9 +273,12 @@ Z2 Z2::operator-(Z2 &other) { return -other + *this; }
  * @param other The Z2 object to be multiplied with the current object.
  * @return The result of the multiplication.
  */
-Z2 Z2::operator*(const Z2 &other) const
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::operator*(const basic_Z2 &other) const
 {   
-    return Z2(intPart * other.intPart + ((sqrt2Part * other.sqrt2Part) << 1), intPart * other.sqrt2Part + sqrt2Part * other.intPart, exponent + other.exponent);
+    basic_Z2 prod;
+    overflow |= !prod.assign_product(*this, other);
+    return prod;
 }
 
 /**
@@ -326,7 +287,8 @@ Z2 Z2::operator*(const Z2 &other) const
  * @param other The Z2 object to be multiplied with the current object.
  * @return The result of the multiplication.
  */
-void Z2::zero_mask_multiply(const Z2 &other) 
+template <typename Int>
+void basic_Z2<Int>::zero_mask_multiply(const basic_Z2 &other) 
 {
     // Maybe slightly faster to bit twiddle.
     if(other.intPart == 0) {
@@ -344,11 +306,12 @@ void Z2::zero_mask_multiply(const Z2 &other)
  * @param other The Z2 object to divide the current object by.
  * @return The result of the division.
  */
-Z2 Z2::operator/(const Z2 &other) const
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::operator/(const basic_Z2 &other) const
 {   
     // If this is 0, we can't do division.     
     // If other is 0, then by virtue of other generating this, this is also 0, so don't need to check
-    if(intPart == 0) return Z2(0,0,0);   
+    if(intPart == 0) return basic_Z2(0,0,0);   
  
     // Neither is 0 now, so we can do division. Assume that other was one of the terms in the 
     // original product and we did not reduce it. This will fail if we reduced it and we would need
@@ -360,7 +323,7 @@ Z2 Z2::operator/(const Z2 &other) const
 
     intPartNew /= denominator;
     sqrt2PartNew /= denominator;
-    return Z2(intPartNew, sqrt2PartNew, exponent - other.exponent);
+    return basic_Z2(intPartNew, sqrt2PartNew, exponent - other.exponent);
 }
 
 /**
@@ -369,7 +332,8 @@ Z2 Z2::operator/(const Z2 &other) const
  * @param other The Z2 object to be multiplied with the current object.
  * @return The result of the multiplication.
  */
-void Z2::zero_mask_divide(const Z2 &other) 
+template <typename Int>
+void basic_Z2<Int>::zero_mask_divide(const basic_Z2 &other) 
 {
     // If trying to divide by 0, actually divide by the mask 3. No other work needed.
     if(other.intPart == 0) {
@@ -390,7 +354,8 @@ void Z2::zero_mask_divide(const Z2 &other)
  * @param other The Z2 object to compare with the current object.
  * @return True if the objects are equal, false otherwise.
  */
-bool Z2::operator==(const Z2 &other) const
+template <typename Int>
+bool basic_Z2<Int>::operator==(const basic_Z2 &other) const
 {
     return (intPart == other.intPart && sqrt2Part == other.sqrt2Part && exponent == other.exponent);
 }
@@ -400,7 +365,8 @@ bool Z2::operator==(const Z2 &other) const
  * @param other reference to Z2 object to be compared to
  * @return true if this < other and false otherwise
  */
-bool Z2::operator==(Z2 &other)
+template <typename Int>
+bool basic_Z2<Int>::operator==(basic_Z2 &other)
 {  
     return (intPart==other.intPart && sqrt2Part==other.sqrt2Part && exponent==other.exponent);
     // return intPart^other.intPart^sqrt2Part^other.sqrt2Part^exponent^other.exponent == 0;
@@ -411,7 +377,8 @@ bool Z2::operator==(Z2 &other)
  * @param other reference to Z2 object to be compared to
  * @return whether or not the entries of the two Z2s are equal
  */
-bool Z2::operator==(const z2_int &i) { return intPart == i && sqrt2Part == 0 && exponent == 0; }
+template <typename Int>
+bool basic_Z2<Int>::operator==(const Int &i) { return intPart == i && sqrt2Part == 0 && exponent == 0; }
 
 /**
  * Overloads the != operator for Z2 objects.
@@ -419,7 +386,8 @@ bool Z2::operator==(const z2_int &i) { return intPart == i && sqrt2Part == 0 &&
  * @param other The Z2 object to compare with the current object.
  * @return True if the objects are not equal, false otherwise.
  */
-bool Z2::operator!=(const Z2 &other) const { return !(*this == other); }
+template <typename Int>
+bool basic_Z2<Int>::operator!=(const basic_Z2 &other) const { return !(*this == other); }
 
 // inline uint32_t Z2::as_uint32() const {
 //     // return int32_t((intPart << 16)^(sqrt2Part << 8 )^(exponent));
@@ -438,7 +406,8 @@ bool Z2::operator!=(const Z2 &other) const { return !(*this == other); }
  * @param other The Z2 object to compare with the current object.
  * @return True if the current object is less than 'other', false otherwise.
  */
-bool Z2::operator<(const Z2 &other) const
+template <typename Int>
+bool basic_Z2<Int>::operator<(const basic_Z2 &other) const
 {
     if(intPart<other.intPart)   return true;
     if(intPart==other.intPart) 
@@ -449,7 +418,8 @@ bool Z2::operator<(const Z2 &other) const
     return false;
 }
 
-bool Z2::abs_less(const Z2 &other) {
+template <typename Int>
+bool basic_Z2<Int>::abs_less(const basic_Z2 &other) {
     if(intPart < other.intPart) return true;
     if(intPart == other.intPart) {
         if(sqrt2Part < other.sqrt2Part) return true;
@@ -464,7 +434,8 @@ bool Z2::abs_less(const Z2 &other) {
  * @param other The Z2 object to compare with the current object.
  * @return True if the current object is less than 'other', false otherwise.
  */
-bool Z2::is_negative() const
+template <typename Int>
+bool basic_Z2<Int>::is_negative() const
 {
     if(intPart<0) 
         return true;
@@ -477,7 +448,8 @@ bool Z2::is_negative() const
  * @param other The Z2 object to compare with the current object.
  * @return True if the current object is greater than 'other', false otherwise.
  */
-bool Z2::operator>(Z2 &other) { return (other < *this); }
+template <typename Int>
+bool basic_Z2<Int>::operator>(basic_Z2 &other) { return (other < *this); }
 
 /**
  * Overloads the >= operator for Z2 objects.
@@ -485,7 +457,8 @@ bool Z2::operator>(Z2 &other) { return (other < *this); }
  * @param other The Z2 object to compare with the current object.
  * @return True if the current object is greater than or equal to 'other', false otherwise.
  */
-bool Z2::operator>=(Z2 &other) { return !(*this < other); }
+template <typename Int>
+bool basic_Z2<Int>::operator>=(basic_Z2 &other) { return !(*this < other); }
 
 /**
  * Overloads the <= operator for Z2 objects.
@@ -493,14 +466,16 @@ bool Z2::operator>=(Z2 &other) { return !(*this < other); }
  * @param other The Z2 object to compare with the current object.
  * @return True if the current object is less than or equal to 'other', false otherwise.
  */
-bool Z2::operator<=(Z2 &other) { return !(*this > other); }
+template <typename Int>
+bool basic_Z2<Int>::operator<=(basic_Z2 &other) { return !(*this > other); }
 
 /**
  * Overloads the = operator for Z2
  * @param other reference to object make *this equal to
  * @return *this reference to this object which has been made equal to other
  */
-Z2 &Z2::operator=(const z2_int &other)
+template <typename Int>
+basic_Z2<Int> &basic_Z2<Int>::operator=(const Int &other)
 {
     intPart = other;
     sqrt2Part = 0;
@@ -520,7 +495,8 @@ Z2 &Z2::operator=(const z2_int &other)
  * @param other reference to object make *this equal to
  * @return *this reference to this object which has been made equal to other
  */
-Z2 &Z2::operator=(const Z2 &other)
+template <typename Int>
+basic_Z2<Int> &basic_Z2<Int>::operator=(const basic_Z2 &other)
 {
     // // assigns an operator
     intPart = other.intPart;
@@ -536,7 +512,8 @@ Z2 &Z2::operator=(const Z2 &other)
  * @param other The Z2 object whose values are to be copied.
  * @return A reference to the current object after the assignment.
  */
-Z2 &Z2::operator=(Z2 &other)
+template <typename Int>
+basic_Z2<Int> &basic_Z2<Int>::operator=(basic_Z2 &other)
 {
     // assigns an operator
     intPart = other.intPart;
@@ -556,30 +533,10 @@ Z2 &Z2::operator=(Z2 &other)
  * 
  * @return A reference to this object in its simplified form.
  */
-Z2 &Z2::reduce()
+template <typename Int>
+basic_Z2<Int> &basic_Z2<Int>::reduce()
 {
-    // Assume that reduce() doesn't get called if intPart == 0;
-        if (!(intPart) && !(sqrt2Part))          // If it's 0, it's reduced.
-        { 
-            exponent = 0;         
-            return *this;       // Can we make all of these point to the same thing? Where would this go wrong? There may be a lot of 0s.
-        }
-
-        // reduces a Z2 to its lowest denominator exponent (DE) expression, can be negative, but maybe should require positive?
-        // If a is even, (a + b√2)/√2^k ↦ (b + (a/2)√2)/√2^(k-1) in each iteration
-        // bool integer_part_index = 0;
-        
-        // loop until one of the two parts becomes odd
-        while (!(intPart & 1) && !(sqrt2Part & 1)) {
-            intPart >>= 1;
-            sqrt2Part >>= 1;
-            exponent -= 2;
-        }
-        if (!(intPart & 1)) {
-            std::swap(intPart, sqrt2Part);
-            sqrt2Part >>= 1;
-            exponent--;
-        }
+    assign_reduced(intPart, sqrt2Part, exponent);
     return *this;
 }
 
@@ -594,7 +551,8 @@ Z2 &Z2::reduce()
  * @param z The Z2 object to be output.
  * @return A reference to the output stream.
  */
-std::ostream& operator<<(std::ostream& os, const Z2& z){
+template <typename Int>
+std::ostream& operator<<(std::ostream& os, const basic_Z2<Int>& z){
     os << (int) z.intPart << "," << (int) z.sqrt2Part << "e" << (int) z.exponent;
     return os;
 }
@@ -610,10 +568,19 @@ std::ostream& operator<<(std::ostream& os, const Z2& z){
  * 
  * @return Z2 A new Z2 object representing the absolute value.
  */
-Z2 Z2::abs() {
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::abs() {
     return (intPart < 0) ? -*this : *this;
 }
 
-Z2 Z2::abs() const{
+template <typename Int>
+basic_Z2<Int> basic_Z2<Int>::abs() const{
     return (intPart < 0) ? -*this : *this;
 }
+
+template class basic_Z2<int8_t>;
+template class basic_Z2<int16_t>;
+template class basic_Z2<int32_t>;
+template std::ostream& operator<<(std::ostream&, const basic_Z2<int8_t>&);
+template std::ostream& operator<<(std::ostream&, const basic_Z2<int16_t>&);
+template std::ostream& operator<<(std::ostream&, const basic_Z2<int32_t>&);
@@ -2,44 +2,52 @@
 #define Z2_HPP
 
 #include <array>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
 
 typedef int8_t z2_int;
 typedef uint8_t uz2_int;
 
-class Z2{
+template <typename Int>
+class basic_Z2{
 // elements of Z[1/sqrt(2)] are stored in the form (intPart + sqrt2Part*sqrt(2))/2^exponent
 public:
-    Z2(const z2_int,const z2_int,const z2_int); // the ints paseed form the entries of val
-    Z2();// the entries of val are all 0
+    basic_Z2(const Int,const Int,const Int); // the ints paseed form the entries of val
+    basic_Z2();// the entries of val are all 0
+    template <typename Other> explicit basic_Z2(const basic_Z2<Other> &other) : intPart(other.intPart), sqrt2Part(other.sqrt2Part), exponent(other.exponent) {} // widening copy
     // inline uint32_t as_uint32() const;
-    Z2 operator+(const Z2&) const; //handles addition
-    Z2& operator+=(const Z2&); //handles +=
-    Z2& abs_add(const Z2&); //handles +=
-    Z2& abs_subtract(const Z2&); //handles +=
-    Z2& operator-=(const Z2&); //handles -=
-    Z2 operator-() const; //handles negation
-    Z2 operator-(Z2&); //handles subtraction
-    bool operator<(const z2_int&);
-    bool operator<(const Z2&) const;
-    bool operator>(const z2_int&);
-    bool operator>(Z2&);
-    bool operator<=(Z2&);
-    bool operator>=(Z2&);
+    basic_Z2 operator+(const basic_Z2&) const; //handles addition
+    basic_Z2& operator+=(const basic_Z2&); //handles +=
+    basic_Z2& abs_add(const basic_Z2&); //handles += |other|
+    basic_Z2& abs_subtract(const basic_Z2&); //handles -= |other|
+    basic_Z2& operator-=(const basic_Z2&); //handles -=
+    static void add(basic_Z2*, const basic_Z2*, const int&); // element-wise += over n entries, e.g. a column
+    static void subtract(basic_Z2*, const basic_Z2*, const int&); // element-wise -= over n entries
+    static void multiply(basic_Z2*, const basic_Z2*, const basic_Z2&, const int&); // dst[i] = src[i] * s over n entries
+    basic_Z2 operator-() const; //handles negation
+    basic_Z2 operator-(basic_Z2&); //handles subtraction
+    bool operator<(const Int&);
+    bool operator<(const basic_Z2&) const;
+    bool operator>(const Int&);
+    bool operator>(basic_Z2&);
+    bool operator<=(basic_Z2&);
+    bool operator>=(basic_Z2&);
     // Z2 operator*(const Z2); //function that handles multiplication
     // Z2 operator*(Z2&); //function that handles multiplication
-    Z2 operator*(const Z2&) const; //function that handles multiplication
-    void zero_mask_multiply(const Z2&);
-    void zero_mask_divide(const Z2&);
-    Z2 operator/(const Z2&) const; //function that handles multiplication
-    bool operator==(const Z2&) const; //function that checks equality between two Z2
-    bool operator==(Z2&);
-    bool operator==(const z2_int&); //function that checks equality between two Z2
-    bool operator!=(const Z2&) const; //function that checks equality between two Z2
-    Z2& operator=(const z2_int&); //function that makes the operator have equal entries to parameter
-    Z2& operator=(const Z2&); //function that makes the operator have equal entries to parameter
-    Z2& operator=(Z2&); //function that makes the operator have equal entries to parameter
-    Z2 abs(); //function that returns the magnitude of the operator
-    Z2 abs() const; //function that returns the magnitude of the operator
+    basic_Z2 operator*(const basic_Z2&) const; //function that handles multiplication
+    void zero_mask_multiply(const basic_Z2&);
+    void zero_mask_divide(const basic_Z2&);
+    basic_Z2 operator/(const basic_Z2&) const; //function that handles multiplication
+    bool operator==(const basic_Z2&) const; //function that checks equality between two Z2
+    bool operator==(basic_Z2&);
+    bool operator==(const Int&); //function that checks equality between two Z2
+    bool operator!=(const basic_Z2&) const; //function that checks equality between two Z2
+    basic_Z2& operator=(const Int&); //function that makes the operator have equal entries to parameter
+    basic_Z2& operator=(const basic_Z2&); //function that makes the operator have equal entries to parameter
+    basic_Z2& operator=(basic_Z2&); //function that makes the operator have equal entries to parameter
+    basic_Z2 abs(); //function that returns the magnitude of the operator
+    basic_Z2 abs() const; //function that returns the magnitude of the operator
     // Z2 zero_mask() {
     //     return Z2(3*(intPart==0), 0, 0);
     // }
@@ -48,8 +56,8 @@ public:
     //         return Z2(3, 0, 0);
     //     }
     // }
-    bool abs_less(const Z2&);
-    friend std::ostream& operator<<(std::ostream&,const Z2&); //display
+    bool abs_less(const basic_Z2&);
+    template <typename I> friend std::ostream& operator<<(std::ostream&,const basic_Z2<I>&); //display
     void negate(){intPart=-intPart;sqrt2Part=-sqrt2Part;}
     bool is_negative() const;
 
@@ -58,11 +66,23 @@ public:
         if(intPart!=0) exponent++;
     }
 
-    z2_int intPart;
-    z2_int sqrt2Part;
-    z2_int exponent; //denominator exponent
+    Int intPart;
+    Int sqrt2Part;
+    Int exponent; //denominator exponent
+
+    /// @brief Set by any operation whose result did not fit in Int since the flag was last cleared. Per thread, never cleared by Z2 itself.
+    static inline thread_local bool overflow = false;
+    /// @brief Largest LDE whose entries always fit: |a| + |b|√2 ≤ √2^LDE for entries of an orthogonal matrix.
+    static constexpr int max_lde = 2 * (8 * sizeof(Int) - 1);
+
 private:
-    Z2& reduce(); //auxiliary function to make sure every triad is in a consistent most reduced form
+    using Wide = std::conditional_t<(sizeof(Int) < 4), int, int64_t>; // holds every intermediate of one operation
+    bool add_parts(Wide, Wide, const int); // branch-free += of (c + d√2)/√2^f, false on overflow
+    bool assign_reduced(Wide, Wide, const int);
+    bool assign_product(const basic_Z2&, const basic_Z2&);
+    basic_Z2& reduce(); //auxiliary function to make sure every triad is in a consistent most reduced form
 };
 
+using Z2 = basic_Z2<z2_int>;
+
 #endif // Z2_HPP
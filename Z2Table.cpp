@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include "Z2Table.hpp"
+
+int Z2Table::n = 0;
+int Z2Table::lde_max = -1;
+std::vector<Z2> Z2Table::entries;
+std::vector<uint8_t> Z2Table::index;
+std::vector<uint8_t> Z2Table::t_sum;
+std::vector<uint8_t> Z2Table::t_diff;
+
+/**
+ * @brief Reduced entries (a + b√2)/√2^e of an orthogonal matrix with e ≤ lde, zero first.
+ */
+static std::vector<Z2> enumerate_entries(const int &lde)
+{
+    std::vector<Z2> ret = {Z2(0, 0, 0)};
+    for (int e = 0; e <= lde; e++) {
+        const double bound = std::pow(std::sqrt(2.0), e) + 1e-9;
+        for (int a = 1; a <= bound; a += 2) {
+            for (int b = 0; a + b * std::sqrt(2.0) <= bound; b++) {
+                ret.emplace_back(a, b, e);
+                ret.emplace_back(-a, -b, e);
+                if (b == 0) continue;
+                ret.emplace_back(a, -b, e);
+                ret.emplace_back(-a, b, e);
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Enumerates the interned entries and fills the tables.
+ * @param lde largest LDE to intern, reduced to the largest one whose entries fit in a byte
+ * @return the LDE actually interned
+ */
+int Z2Table::build(const int &lde)
+{
+    lde_max = std::min(lde, 0);
+    for (int l = std::max(lde, 0); l >= 0; l--) {
+        if (enumerate_entries(l).size() < none) {
+            lde_max = l;
+            break;
+        }
+    }
+    entries = enumerate_entries(lde_max);
+    n = entries.size();
+
+    index.assign((lde_max + 1) << 10, none);
+    for (int o = 0; o < n; o++) {
+        const Z2 &z = entries[o];
+        index[(z.exponent << 10) | ((z.intPart + 16) << 5) | (z.sqrt2Part + 16)] = o;
+    }
+
+    t_sum.assign(n * n, none);
+    t_diff.assign(n * n, none);
+    for (int x = 0; x < n; x++) {
+        for (int y = 0; y < n; y++) {
+            Z2 sum = entries[x] + entries[y];
+            Z2 diff = entries[y] + (-entries[x]);
+            sum.increaseDE();
+            diff.increaseDE();
+            t_sum[x * n + y] = ordinal(sum);
+            t_diff[x * n + y] = ordinal(diff);
+        }
+    }
+    return lde_max;
+}
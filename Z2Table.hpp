@@ -0,0 +1,57 @@
+#ifndef Z2TABLE_HPP
+#define Z2TABLE_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "Z2.hpp"
+
+/**
+ * @file Z2Table.hpp
+ * @brief Interned Z2 entries with a table-driven T step.
+ *
+ * Every entry of an orthogonal matrix with LDE at most L is a reduced (a + b√2)/√2^e with e ≤ L and
+ * |a| + |b|√2 ≤ √2^e, since both the entry and its √2-conjugate have magnitude at most 1. build() enumerates
+ * these entries and numbers them, and an ordinal only names an entry: ordinal() looks it up, entry() reads it back and
+ * t_step() maps a pair of ordinals to the pair after one T step. Ordinals carry no order and are never compared.
+ * There are 183 entries up to L = 7 and the count doubles with every further exponent, so L is capped at 7 to keep
+ * ordinals in a byte. Results that leave the table are Z2Table::none and the caller falls back to Z2 arithmetic.
+ */
+class Z2Table {
+    public:
+        static constexpr uint8_t none = 255;
+
+        static int build(const int &);
+        static inline bool built() { return n > 0; }
+        static inline int max_lde() { return lde_max; }
+        static inline int size() { return n; }
+
+        /// @brief Ordinal of z, or none if z is not interned.
+        static inline uint8_t ordinal(const Z2 &z) {
+            const unsigned a = z.intPart + 16, b = z.sqrt2Part + 16, e = z.exponent;
+            if ((a | b) >= 32 || e >= (unsigned) (lde_max + 1)) return none;
+            return index[(e << 10) | (a << 5) | b];
+        }
+        static inline const Z2 &entry(const uint8_t &o) { return entries[o]; }
+
+        /**
+         * @brief One column of a T multiplication on rows (x, y): x ↦ (x + y)/√2 and y ↦ (y - x)/√2.
+         * @return false if either result is not interned
+         */
+        static inline bool t_step(uint8_t &x, uint8_t &y) {
+            const int i = x * n + y;
+            const uint8_t s = t_sum[i], d = t_diff[i];
+            x = s;
+            y = d;
+            return (s != none) & (d != none);
+        }
+
+    private:
+        static int n;
+        static int lde_max;
+        static std::vector<Z2> entries;
+        static std::vector<uint8_t> index;      // (e, a + 16, b + 16) -> ordinal; |a|, |b| < 16 for every interned entry
+        static std::vector<uint8_t> t_sum, t_diff;
+};
+
+#endif // Z2TABLE_HPP
@@ -10,6 +10,8 @@
  */
 
 #include <chrono>
+#include <numeric>
+#include <tuple>
 #include <set>
 #include <fstream>
 #include <vector>
@@ -17,61 +19,24 @@
 #include <thread>
 #include <dirent.h> // Directory Entry
 #include "Globals.hpp"
+#include "Progress.hpp"
+#include "ResultWriter.hpp"
+#include "Numa.hpp"
+#include "UniformSO6.hpp"
+#include "PatternGraph.hpp"
+#include "PatternIndex.hpp"
 #include "utils.hpp"
 
 using namespace std;
 
-/**
- * @brief Inserts all permutations of a given pattern into a set.
- * 
- * This function generates all permutations of the input pattern and inserts them into a set. 
- * It also considers modifications of each permutation by toggling the rows, and includes the transposed version of the pattern.
- * 
- * @param p The pattern to permute and modify.
- */
-static std::set<pattern> permutation_set(pattern &pat)
-{   
-    // Insert the original pattern into the set
-    std::set<pattern> perms;
-    std::set<pattern> inits;
-    inits.insert(pat);
-    inits.insert(pat.transpose());
-
-    for(pattern p : inits) {
-        perms.insert(p); 
-        // Initialize an array to represent the rows of the pattern
-        int row[6] = {0, 1, 2, 3, 4, 5};
-
-        // Generate all permutations of the pattern
-        while (std::next_permutation(row, row + 6))
-        {
-            // Create a new pattern based on the current permutation
-            pattern perm_of_orig;
-            for (int c = 0; c < 6; c++)
-            {
-                for (int r = 0; r < 6; r++)
-                    perm_of_orig.arr[c][r] = p.arr[c][row[r]];
-            }
-            // Order the new pattern lexicographically and insert it into the set
-            perm_of_orig.lexicographic_order();
-            perms.insert(perm_of_orig);
-            // Iterate over all possible combinations of row modifications
-            for(unsigned int counter = 0; counter < (1 << 6); counter++) {
-                pattern mod_of_perm = perm_of_orig; // Start with a copy of the original permutation
-                for(int j = 0; j < 6; j++) {
-                    if((counter >> j) & 1) {
-                        // Modify the j-th row if the j-th bit of 'counter' is set
-                        mod_of_perm.mod_row(j);
-                    }
-                }
-                // Order the modified pattern lexicographically and insert it into the set
-                mod_of_perm.lexicographic_order();
-                perms.insert(mod_of_perm);
-            }
-        }
-    }
-    return perms;
-}
+static Progress progress;   // Progress and ETA reporting for the current phase
+static ResultWriter writer; // Writes the circuits found at the current T count
+static std::map<pattern, std::string> orbit_ids;    // least pattern of each orbit in the pattern file to its line there
+static std::set<pattern> hit_orbits;                // least pattern of each orbit hit so far
+static std::size_t named_hits = 0;                  // orbits hit so far that were read from the pattern file
+static std::vector<std::string> first_hits;         // T count, time and line of the first hit of each orbit, in order
+static int hit_T_count = 0;                         // T count of the matrices being probed
+static std::chrono::high_resolution_clock::time_point search_init_time = std::chrono::high_resolution_clock::now();
 
 /**
  * @brief Inserts all permutations of a given pattern into a set.
@@ -81,16 +46,22 @@ static std::set<pattern> permutation_set(pattern &pat)
  * 
  * @param p The pattern to permute and modify.
  */
-static void insert_all_permutations(pattern &p)
+static pattern insert_all_permutations(pattern &p)
 {   
-    std::set<pattern> perms_of_p = permutation_set(p); 
+    std::set<pattern> perms_of_p = pattern::permutation_set(p); 
     pattern_set.insert(perms_of_p.begin(),perms_of_p.end());
+    return *perms_of_p.begin();
 }
 
-static void erase_all_permutations(pattern &p)
+/// @return the least pattern of the orbit, which identifies it
+static pattern erase_all_permutations(pattern &p)
 {
-    std::set<pattern> perms_of_p = permutation_set(p);
-    for(const pattern &erase : perms_of_p) pattern_set.erase(erase);
+    std::set<pattern> perms_of_p = pattern::permutation_set(p);
+    for(const pattern &erase : perms_of_p) {
+        pattern_set.erase(erase);
+        PatternIndex::erase(erase);
+    }
+    return *perms_of_p.begin();
 }
 
 /// @brief Reads binary patterns from a file and processes them.
@@ -121,7 +92,7 @@ static void read_pattern_file(std::string pattern_file_path)
         currentPattern.id = line;
         currentPattern.lexicographic_order();
         // std::cout << currentPattern;
-        insert_all_permutations(currentPattern);
+        orbit_ids.emplace(insert_all_permutations(currentPattern), line);
     }
 
     patternFile.close(); // Close file after processing
@@ -130,6 +101,7 @@ static void read_pattern_file(std::string pattern_file_path)
     pattern identityPattern = pattern::identity();
     pattern_set.erase(identityPattern);
     pattern_set.erase(identityPattern.pattern_mod());
+    patterns_remaining.store(pattern_set.size(), std::memory_order_relaxed);
     std::cout << "[Finished] Loaded " << pattern_set.size() << " non-identity patterns." << std::endl;
 }
 
@@ -194,18 +166,55 @@ static std::chrono::_V2::high_resolution_clock::time_point now()
     return chrono::_V2::high_resolution_clock::now();
 }
 
+static std::string time_since(std::chrono::_V2::high_resolution_clock::time_point &s)
+{
+    chrono::duration<double> duration = now() - s;
+    int64_t time = chrono::duration_cast<chrono::milliseconds>(duration).count();
+    if (time < 1000)
+        return std::to_string(time).append("ms");
+    if (time < 60000)
+        return std::to_string((float)time / 1000).substr(0, 5).append("s");
+    if (time < 3600000)
+        return std::to_string((float)time / 60000).substr(0, 5).append("min");
+    if (time < 86400000)
+        return std::to_string((float)time / 3600000).substr(0, 5).append("hr");
+    return std::to_string((float)time / 86400000).substr(0, 5).append("days");
+}
+
+/**
+ * @brief Records the T count and time of the first hit of an orbit, named by its line in the pattern file. The
+ *        permutations of a hit need not give back the orbit that was read, so an orbit can be hit again, which is not
+ *        recorded, and an orbit whose least pattern was not read is named by the bits of that pattern instead and not
+ *        counted among named_hits.
+ * @param orbit least pattern of the orbit
+ */
+static void record_first_hit(const pattern &orbit) {
+    if (!hit_orbits.insert(orbit).second) return;
+    auto it = orbit_ids.find(orbit);
+    std::string name;
+    if (it != orbit_ids.end()) {
+        name = it->second;
+        named_hits++;
+    } else {
+        const bool *bits = orbit.to_binary();
+        for (int i = 0; i < 72; i++) name += bits[i] ? '1' : '0';
+    }
+    first_hits.push_back(std::to_string(hit_T_count) + "\t" + time_since(search_init_time) + "\t" + name);
+}
+
 /**
  * @brief Erases the pattern of an SO6 from pattern_set
  * @param s the SO6 to be erased
  */
-static bool erase_pattern(SO6 &s) {
-    pattern pat = s.to_pattern();
+static bool erase_pattern(pattern pat) {
     bool ret = false;
     if (pattern_set.find(pat) != pattern_set.end()) {
         omp_set_lock(&lock);
         // Double check after grabbing the lock
         if (pattern_set.find(pat) != pattern_set.end()) {
-            erase_all_permutations(pat);
+            pattern orbit = erase_all_permutations(pat);
+            patterns_remaining.store(pattern_set.size(), std::memory_order_relaxed);
+            record_first_hit(orbit);
             ret = true;
         } 
         omp_unset_lock(&lock);
@@ -213,22 +222,112 @@ static bool erase_pattern(SO6 &s) {
     return ret;
 }
 
+static bool erase_pattern(SO6 &s) {
+    return erase_pattern(s.to_pattern());
+}
+
 /**
  * @brief Erases the pattern of an SO6 from pattern_set
  * @param s the SO6 to be erased
  */
-static void record_pattern(SO6 &s, std::ofstream& of) {
-    omp_set_lock(&lock);
-    of << s.circuit_string() << std::endl;
-    omp_unset_lock(&lock);
+static void record_pattern(std::string &&circuit) {
+    writer.push(omp_get_thread_num(), std::move(circuit));
+}
+
+static void record_pattern(SO6 &s) {
+    record_pattern(s.circuit_string());
 }
 
 /**
  * @brief Erases the pattern of an SO6 from pattern_set
  * @param s the SO6 to be erased
  */
-static void erase_and_record_pattern(SO6 &s, std::ofstream& of) {
-    if(erase_pattern(s)) record_pattern(s,of);
+static void erase_and_record_pattern(SO6 &s) {
+    if(erase_pattern(s)) record_pattern(s);
+}
+
+/**
+ * @brief Entry width in bits for products of T count t: the narrowest one whose max_lde covers t, since LDE ≤ T count.
+ */
+static int product_width(const int &t) {
+    if (t <= basic_Z2<int8_t>::max_lde) return 8;
+    if (t <= basic_Z2<int16_t>::max_lde) return 16;
+    return 32;
+}
+
+/**
+ * @brief Erases and records the pattern of G*S, computed with entries of the given width, or narrower ones if the LDEs
+ *        of the factors bound the product's LDE below it. A product whose overflow flag is raised anyway is recomputed
+ *        with the next wider entries, so a pattern is never taken from wrapped entries.
+ */
+static void erase_and_record_product(const SO6 &G, const SO6 &S, int width) {
+    width = std::min(width, product_width(G.getLDE() + S.getLDE()));
+    if (width == 8) {
+        Z2::overflow = false;
+        SO6 N = G*S;
+        if (!Z2::overflow) {
+            erase_and_record_pattern(N);
+            return;
+        }
+    }
+    pattern pat;
+    if (width <= 16) {
+        basic_Z2<int16_t>::overflow = false;
+        pat = G.product_pattern<int16_t>(S);
+    }
+    if (width > 16 || basic_Z2<int16_t>::overflow) pat = G.product_pattern<int32_t>(S);
+    if (erase_pattern(pat)) record_pattern(SO6::circuit_string(pat.hist));
+}
+
+/// @brief A product of the free multiply whose pattern waits in a thread's batch to be probed.
+struct Probe {
+    PatternIndex::Key key;
+    std::size_t slot;
+    uint64_t i;     // stored matrix to_compute[i]
+    uint32_t g;     // generator gens[level][g]
+};
+
+static constexpr std::size_t probe_batch = 4096;
+
+/// @brief What the residues tell of the pattern of G*S, and so of every product of the bucket of G with S.
+enum Outlook : char { unwanted_pattern = 0, unknown_pattern = 1, wanted_pattern = 2 };
+
+static Outlook outlook(const SO6 &G, const SO6 &S) {
+    uint64_t residues[2];
+    if (!SO6::product_residues(G, S, residues)) return unknown_pattern;
+    return PatternIndex::contains(PatternIndex::key(residues)) ? wanted_pattern : unwanted_pattern;
+}
+
+/**
+ * @brief Stored matrices of one thread that share a bucket, and so the outlook of their products with every bucket of
+ *        the generating set. Runs are scored by the products they give whose pattern is known to be wanted, then by
+ *        those whose pattern is unknown, and taken best first.
+ */
+struct Run {
+    uint64_t begin, end;
+    uint64_t wanted = 0, unknown = 0;
+    bool operator>(const Run &other) const {
+        return std::tie(wanted, unknown) > std::tie(other.wanted, other.unknown);
+    }
+};
+
+/**
+ * @brief Scores runs against the patterns still to be found and sorts them best first. Ties keep their order.
+ * @param gens generating set of the level, sorted by bucket
+ * @param starts first element of every bucket of gens, and gens.size()
+ */
+static void score_runs(std::vector<Run>::iterator first, std::vector<Run>::iterator last, const SO6Array &to_compute,
+                       const SO6Vector &gens, const std::vector<std::size_t> &starts)
+{
+    for (auto run = first; run != last; ++run) {
+        run->wanted = run->unknown = 0;
+        for (std::size_t b = 0; b + 1 < starts.size(); b++) {
+            const Outlook o = outlook(gens[starts[b]], to_compute[run->begin]);
+            if (o == wanted_pattern) run->wanted += starts[b+1] - starts[b];
+            if (o == unknown_pattern) run->unknown += starts[b+1] - starts[b];
+        }
+    }
+    std::stable_sort(first, last, std::greater<Run>());
 }
 
 /// @brief Reads dat file and prints string of gates circuit
@@ -247,21 +346,6 @@ static void read_dat(std::string file_name) {
     }
 }
 
-static std::string time_since(std::chrono::_V2::high_resolution_clock::time_point &s)
-{
-    chrono::duration<double> duration = now() - s;
-    int64_t time = chrono::duration_cast<chrono::milliseconds>(duration).count();
-    if (time < 1000)
-        return std::to_string(time).append("ms");
-    if (time < 60000)
-        return std::to_string((float)time / 1000).substr(0, 5).append("s");
-    if (time < 3600000)
-        return std::to_string((float)time / 60000).substr(0, 5).append("min");
-    if (time < 86400000)
-        return std::to_string((float)time / 3600000).substr(0, 5).append("hr");
-    return std::to_string((float)time / 86400000).substr(0, 5).append("days");
-}
-
 /**
  * @brief Method to report the start of a T count iteration
  * @param T the number of the current T count
@@ -271,28 +355,13 @@ static void report_begin_T_count(const int T) {
     tcount_init_time = now();
 }
 
-/**
- * @brief Method to report percentage completed
- * @param c current integer countr
- * @param s total size
- */
-inline static void report_percent_complete(const uint64_t &c, const uint64_t s)
-{
-    if ((c & 0x7F) == 0) // if c is divisible by 128
-    {
-        std::cout << "\033[A\033[A\r ||\t↪ [Progress] Processing .....    "
-                  << (100*c/s) << "\%" << "\n ||\t↪ [Patterns] "
-                  << pattern_set.size() << " patterns remain." << std::endl;
-    }
-}
-
 /**
  * @brief Function to report completion
  * @param matrices_found how many matrices were found
  */
 static void finish_io(const uint &matrices_found, const bool b, std::ofstream &of) {
-    std::cout << "\033[A\033[A\r ||\t↪ [Progress] Processing .....    100\%" << std::endl; 
-    std::cout << " ||\t↪ [Patterns] " << pattern_set.size() << " patterns remain." << std::endl;
+    progress.end();
+    writer.end();
     if(b) std::cout << " ||\t↪ [Finished] Found " << matrices_found << " new matrices in " << time_since(tcount_init_time) << "\n ||" << std::endl;
     else std::cout << " ||\t↪ [Finished] Completed in " << time_since(tcount_init_time) << "\n ||" << std::endl;
     of.close();
@@ -322,11 +391,34 @@ static std::ofstream prepare_T_count_io(const int t, uint8_t &stored_depth_max,
         std::cout << " ||\t↪ [Rep] Left multiplying everything by T₀\n";
     if(t > stored_depth_max+1) 
         std::cout << " ||\t↪ [Rep] Using generating_set[" << t-stored_depth_max-1 << "]\n";
-    std::cout << " ||\t↪ [Progress] Processing .....    0\%\n"
-                << " ||\t↪ [Patterns] " << pattern_set.size() << " patterns remain." << std::endl;
+    std::cout << std::flush;
     return of;
 }
 
+/**
+ * @brief Reports the memory held after a BFS level and predicts the peak of building the next one.
+ *        While level t+1 is built, levels t-1 and t are both alive, so the peak is everything tracked now
+ *        plus the predicted size of level t+1.
+ * @param t T count of the level that was just completed (now held in current)
+ * @param prior the level t-1
+ * @param current the level t
+ */
+static void report_memory(const int t, const SO6Set &prior, const SO6Set &current)
+{
+    uint64_t prior_heap = Memory::sampled_heap_bytes(prior);
+    uint64_t current_heap = Memory::sampled_heap_bytes(current);
+    Memory::record_level(t, current.size(), current.get_allocator().account->bytes() + current_heap);
+    Memory::report("end of T=" + std::to_string(t));
+    std::cout << " ||\t↪ [Memory] Element heap of levels T=" << t-1 << ",T=" << t << ": " << Memory::format_bytes(prior_heap + current_heap) << "\n";
+
+    if (t >= stored_depth_max) return;
+    uint64_t next_size = Memory::predict_level_size(t+1);
+    uint64_t next_bytes = next_size * Memory::bytes_per_matrix();
+    uint64_t peak = Memory::tracked_bytes() + prior_heap + current_heap + next_bytes;
+    std::cout << " ||\t↪ [Memory] Predicted T=" << t+1 << ": ~" << next_size << " matrices, "
+              << Memory::format_bytes(next_bytes) << ", peak ~" << Memory::format_bytes(peak) << "\n ||" << std::endl;
+}
+
 /**
  * @brief Store specific cosets T_0{curr} based on the current T count and free multiply depth.
  * This method saves a subset of the SO6 objects to the generating set, which are used in later iterations.
@@ -338,13 +430,15 @@ static std::ofstream prepare_T_count_io(const int t, uint8_t &stored_depth_max,
  * @param generating_set Reference to an array of vectors of SO6 objects to store the generated sets.
  */
 void storeCosets(int curr_T_count, 
-                 std::set<SO6>& current, std::vector<SO6> &generating_set)
+                 SO6Set& current, SO6Vector &generating_set)
 {
     int ngs = utils::num_generating_sets(target_T_count,stored_depth_max);
     if (curr_T_count < ngs)
     {
         std::cout << "\033[A\r ||\t↪ [Save] Saving coset T₀{T=" << curr_T_count + 1 << "} as generating_set[" << curr_T_count << "]\n ||" << std::endl;
-        generating_set = std::vector<SO6>(current.begin(),current.end());
+        generating_set.assign(current.begin(),current.end());
+        // A matrix whose circuit starts with T₀ gives T₀ T₀ M', a row signed permutation of M' by T₀², so its products
+        // have lower T count. That holds for the whole class M Q, since T₀ (M Q) = (T₀ M) Q, so dropping it loses nothing.
         generating_set.erase(std::remove_if(generating_set.begin(), generating_set.end(),
                                 [](SO6& S) {
                                     return (S.circuit_string().back() == '0');
@@ -357,13 +451,134 @@ void storeCosets(int curr_T_count,
     }
 }
 
-set<SO6> SO6s_starting_at(SO6 &tree_root, const int &depth) {
+/**
+ * @brief Copies the generating sets onto every NUMA node the pinned threads run on.
+ *        Every thread of the free multiply reads all of the generating set, so each node gets its own replica,
+ *        built by a thread on that node so that first touch places it locally. The originals are then released.
+ * @param generating_set the generating sets saved by storeCosets
+ * @return replicas indexed by NUMA node, or nothing if threads are unpinned or there is a single node
+ */
+static std::vector<std::vector<SO6Vector>> replicate_generating_sets(std::vector<SO6Vector> &generating_set)
+{
+    std::vector<std::vector<SO6Vector>> replicas;
+    if (!Numa::pinned() || Numa::num_nodes() < 2) return replicas;
+
+    replicas.resize(Numa::num_nodes());
+    std::vector<bool> claimed(Numa::num_nodes(), false);
+    #pragma omp parallel num_threads(THREADS)
+    {
+        int tid = omp_get_thread_num();
+        Numa::pin_thread(tid);
+        int node = Numa::node_of_thread(tid);
+        bool mine = false;
+        #pragma omp critical
+        {
+            if (!claimed[node]) claimed[node] = mine = true;
+        }
+        if (mine) {
+            for (std::size_t k = 0; k < generating_set.size(); k++) {
+                replicas[node].emplace_back(generating_set[k].begin(), generating_set[k].end(),
+                                            Memory::Allocator<SO6>("generating_set[" + std::to_string(k) + "]@" + std::to_string(node)));
+            }
+        }
+    }
+    for (SO6Vector &g : generating_set) SO6Vector(g.get_allocator()).swap(g);
+    std::cout << " ||\t↪ [NUMA] Replicated the generating sets on " << std::count(claimed.begin(), claimed.end(), true) << " nodes\n";
+    return replicas;
+}
+
+static inline const SO6 &as_SO6(const SO6 &S) { return S; }
+static inline const SO6 &as_SO6(const SO6 *S) { return *S; }
+
+/**
+ * @brief Sorts each chunk of the free multiply by SO6::bucket_key, stably so that the order of the stored matrices is
+ *        kept inside every bucket. Chunk t is sorted by a thread of the team, which keeps it on that thread's node.
+ * @param v stored matrices, or pointers to them
+ * @param bounds chunk t is [bounds[t], bounds[t+1])
+ */
+template <typename Array>
+static void sort_chunks_by_bucket(Array &v, const std::vector<uint64_t> &bounds)
+{
+    const int chunks = bounds.size() - 1;
+    #pragma omp parallel num_threads(chunks)
+    for (int t = omp_get_thread_num(); t < chunks; t += omp_get_num_threads()) {
+        std::stable_sort(v.begin() + bounds[t], v.begin() + bounds[t+1],
+                         [](const auto &a, const auto &b) { return as_SO6(a).bucket_key() < as_SO6(b).bucket_key(); });
+    }
+}
+
+/**
+ * @brief Times the last free multiply level, which takes most of its time, under every order of the stored matrices, with the chunks the search
+ *        would use, sorted by bucket as the search sorts them when it has patterns to find. Matrices are read through
+ *        pointers from one copy, so this compares the balance and the locality of each order but not its NUMA
+ *        placement. Products are keyed from their residues and looked up in the index, as in the search, but not erased.
+ * @param to_compute the stored matrices
+ * @param generating_set the generating sets, the last level uses the last one that is not empty, or T₀ alone
+ */
+static void benchmark_orders(const SO6Array &to_compute, const std::vector<SO6Vector> &generating_set)
+{
+    std::vector<UniformSO6> ugens;
+    for (const SO6Vector &gens : generating_set) {
+        if (gens.empty()) continue;
+        ugens.clear();
+        for (const SO6 &G : gens) ugens.emplace_back(G);
+    }
+    if (ugens.empty()) ugens.emplace_back(SO6::identity().left_multiply_by_T(0));
+
+    // Every order starts from the order of the stored set
+    std::vector<const SO6*> sorted;
+    sorted.reserve(to_compute.size());
+    for (const SO6 &S : to_compute) sorted.push_back(&S);
+    std::sort(sorted.begin(), sorted.end(), [](const SO6 *a, const SO6 *b) { return *a < *b; });
+
+    PatternIndex::build(pattern_set);
+    std::cout << "[Begin] Timing " << to_compute.size() << " x " << ugens.size() << " products under every order.\n ||" << std::endl;
+    for (const utils::Order &order : {utils::Order::Shuffle, utils::Order::Cost, utils::Order::Residue}) {
+        std::vector<const SO6*> ordered = sorted;
+        utils::order(ordered, order, order_seed);
+        const std::vector<uint64_t> bounds = utils::cost_chunks(ordered, THREADS);
+        if (!pattern_file.empty()) sort_chunks_by_bucket(ordered, bounds);
+
+        std::vector<double> seconds(THREADS, 0);
+        std::atomic<uint64_t> found(0);
+        auto start = now();
+        #pragma omp parallel num_threads(THREADS)
+        {
+            const int tid = omp_get_thread_num();
+            Numa::pin_thread(tid);
+            auto thread_start = now();
+            uint64_t hits = 0;
+            // A smaller team than asked for still takes every chunk
+            for (int t = tid; t < THREADS; t += omp_get_num_threads()) {
+                for (uint64_t i = bounds[t]; i < bounds[t+1]; i++) {
+                    const UniformSO6 US(*ordered[i]);
+                    uint64_t residues[2];
+                    for (const UniformSO6 &UG : ugens) {
+                        UG.product_residues(US, residues);
+                        const PatternIndex::Key key = PatternIndex::key(residues);
+                        hits += PatternIndex::may_contain(key) && PatternIndex::contains(key);
+                    }
+                }
+            }
+            seconds[tid] = std::chrono::duration<double>(now() - thread_start).count();
+            found.fetch_add(hits, std::memory_order_relaxed);
+        }
+        const double wall = std::chrono::duration<double>(now() - start).count();
+        const double slowest = *std::max_element(seconds.begin(), seconds.end());
+        const double mean = std::accumulate(seconds.begin(), seconds.end(), 0.0) / THREADS;
+        std::cout << " ||\t↪ [Order] " << utils::order_name(order) << ": " << wall << "s, slowest thread " << slowest
+                  << "s, mean " << mean << "s, imbalance " << (mean > 0 ? slowest / mean : 1) << ", " << found << " wanted products\n";
+    }
+    std::cout << " ||\n[Finished] Order benchmark complete." << std::endl;
+}
+
+SO6Set SO6s_starting_at(SO6 &tree_root, const int &depth) {
 
-    set<SO6> prior, current = std::set<SO6>({tree_root});
+    SO6Set prior, current({tree_root});
 
     for (int curr_T_count = 0; curr_T_count < depth; ++curr_T_count)
     {
-        set<SO6> next;
+        SO6Set next;
         for (int T = 0; T < 15; T++)
         {                
             for(const SO6& S : current)
@@ -379,44 +594,77 @@ set<SO6> SO6s_starting_at(SO6 &tree_root, const int &depth) {
     return current;
 }
 
-set<pattern> patterns_starting_at(SO6 &tree_root, const int &depth) {
+/**
+ * @brief Census of the residue patterns reachable from tree_root. A BFS on the quotient by pattern: each level keeps
+ *        one matrix per pattern not seen at a lower T count, and only those are expanded, so memory grows with the
+ *        number of patterns rather than of matrices. Every orbit of pattern_set that is reached gets its witness circuit
+ *        written to ./data/census.dat and is erased. Matrices with the same pattern often have different successors, so
+ *        a T count found here is achieved by its witness but can exceed the least one, and an orbit the census does not
+ *        reach can still be reachable.
+ * @param tree_root matrix to start from
+ * @param depth largest T count to expand to
+ * @return every pattern found, without history
+ */
+set<pattern> pattern_census(const SO6 &tree_root, const int &depth) {
+    set<pattern> found_patterns;
+    pattern root_pattern = tree_root.to_pattern();
+    root_pattern.hist.clear();
+    found_patterns.insert(root_pattern);
 
-    set<SO6> prior, current = std::set<SO6>({tree_root});
-    set<pattern> found_patterns = std::set<pattern>({tree_root.to_pattern()});
-    bool flag = false;
-    for (int curr_T_count = 0; curr_T_count < depth; ++curr_T_count)
+    std::ofstream of("./data/census.dat", ios::out | ios::trunc);
+    std::vector<SO6> frontier = {tree_root};
+    std::cout << "\n\n[Begin] Pattern census up to T=" << depth << " with one matrix per pattern\n ||\n";
+    for (int t = 1; t <= depth && !frontier.empty(); t++)
     {
-        if(curr_T_count == depth-1) std::cout << "Depth: " << curr_T_count << " Current size: " << current.size() << std::endl;
-        set<SO6> next;
-        for (int T = 0; T < 15; T++)
-        {                
-            for(const SO6& S : current)
+        report_begin_T_count(t);
+        std::vector<std::vector<SO6>> found_by(THREADS);
+        progress.begin(frontier.size(), THREADS, &patterns_remaining);
+        #pragma omp parallel num_threads(THREADS)
+        {
+            int thread_id = omp_get_thread_num();
+            Numa::pin_thread(thread_id);
+            set<pattern> seen;  // patterns this thread found at this level, found_patterns is only read until the merge
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < frontier.size(); i++)
             {
-                SO6 toInsert = S.left_multiply_by_T(T);
-                pattern p = toInsert.to_pattern();
-                p.lexicographic_order();
-                found_patterns.insert(p);
-                if(pattern_set.find(p) == pattern_set.end()) {
-                    std::cout << "Pattern not found: " << p << std::endl;
-                    std::cout << S << std::endl;
-                    std::cout << toInsert << std::endl;
-                    std::cin.get();
-                    flag = true;
-                    break;
+                progress.tick(thread_id);
+                for (int T = 0; T < 15; T++)
+                {
+                    SO6 N = frontier[i].left_multiply_by_T(T);
+                    pattern p = N.to_pattern();
+                    p.hist.clear();
+                    if (found_patterns.count(p) || !seen.insert(p).second) continue;
+                    found_by[thread_id].push_back(N);
                 }
-                next.insert(toInsert);  
             }
         }
-        utils::setDifference(next,prior);
-        utils::rotate_and_clear(prior, current, next); // current is now ready for next iteration
-        if(flag) {
-            for(pattern p : found_patterns) {
-                erase_all_permutations(p);
+        progress.end();
+
+        // Merged in thread order, so the representatives only depend on the thread count
+        std::vector<SO6> next;
+        uint64_t orbits_reached = 0;
+        for (std::vector<SO6> &candidates : found_by)
+        {
+            for (SO6 &N : candidates)
+            {
+                pattern p = N.to_pattern();
+                p.hist.clear();
+                if (!found_patterns.insert(p).second) continue;
+                if (pattern_set.find(p) != pattern_set.end()) {
+                    erase_all_permutations(p);
+                    of << N.circuit_string() << "\n";
+                    orbits_reached++;
+                }
+                next.push_back(std::move(N));
             }
-            break;
         }
+        patterns_remaining.store(pattern_set.size(), std::memory_order_relaxed);
+        std::cout << " ||\t↪ [Census] " << next.size() << " new patterns, " << orbits_reached << " orbits of pattern_set first reached, "
+                  << pattern_set.size() << " patterns left, in " << time_since(tcount_init_time) << "\n ||" << std::endl;
+        frontier.swap(next);
     }
-
+    of.close();
+    std::cout << "[Finished] Census found " << found_patterns.size() << " patterns, witnesses in ./data/census.dat" << std::endl;
     return found_patterns;
 }
 
@@ -433,16 +681,31 @@ set<pattern> patterns_starting_at(SO6 &tree_root, const int &depth) {
 int main(int argc, char **argv)
 {
     auto program_init_time = now();          // Begin timekeeping
+    search_init_time = program_init_time;
     Globals::setParameters(argc, argv);      // Initialize parameters to command line argument
     Globals::configure();                    // Configure the globals to remove inconsistencies
     read_pattern_file(pattern_file);        // Read the pattern file
+    if (memory_budget && !pattern_set.empty()) Globals::replan(0, 0);   // The patterns are held for the whole search
+    if (census_depth) {
+        pattern_census(root, census_depth);
+        return 0;
+    }
+    if (prune_depth) {
+        PatternGraph::build(root, prune_depth);
+        std::cout << "[Graph] Sampled " << PatternGraph::size() << " patterns and " << PatternGraph::num_edges()
+                  << " transitions up to T=" << (int) prune_depth << " in " << time_since(program_init_time) << std::endl;
+    }
 
-    set<SO6> prior, current = std::set<SO6>({root});
+    SO6Set prior, current(Memory::Allocator<SO6>("level T=0"));
+    current.insert(root);
 
     // This stores the generating sets. Note that the initial generating set is just the 15 T matrices and, thus, doesn't need to be stored
-    int ngs = utils::num_generating_sets(target_T_count, stored_depth_max);
+    // With a memory budget the stored depth may be lowered to ceil(T/2) by a replan, so make room for every set it could need
+    int ngs = utils::num_generating_sets(target_T_count, memory_budget ? std::ceil(target_T_count / 2.0) : stored_depth_max);
+    int sets_saved = 0;
 
-    std::vector<SO6> generating_set[ngs];    
+    std::vector<SO6Vector> generating_set;
+    for (int k = 0; k < ngs; k++) generating_set.emplace_back(Memory::Allocator<SO6>("generating_set[" + std::to_string(k) + "]"));
 
 
     for (int curr_T_count = 0; curr_T_count < stored_depth_max; ++curr_T_count)
@@ -466,33 +729,50 @@ int main(int argc, char **argv)
         //     std::exit(0);
         // }
 
-        set<SO6> next;
+        std::string level_name = "level T=" + std::to_string(curr_T_count+1);
+        SO6Set next(Memory::Allocator<SO6>(level_name, Memory::pool(level_name)));
         std::ofstream of = prepare_T_count_io(curr_T_count+1,stored_depth_max,target_T_count);
 
-        uint64_t count = 0, interval_size = (15*current.size()) / THREADS;
-        
+        // Levels that are not saved as generating sets only feed later levels, so their matrices can be pruned
+        const bool prune = PatternGraph::built() && curr_T_count >= utils::num_generating_sets(target_T_count, stored_depth_max);
+        if (prune) PatternGraph::label(pattern_set);
+        std::atomic<uint64_t> pruned(0);
+
+        progress.begin(15*current.size(), THREADS, &patterns_remaining);
+
         // Calculate the staggered insertion offset
         size_t insert_interval = current.size() / 1000;
         
         // Create a vector of thread-safe sets for parallel insertion
-        std::vector<std::set<SO6>> thread_safe_sets(THREADS);
+        std::vector<SO6Set> thread_safe_sets;
+        for (int k = 0; k < THREADS; k++) {
+            thread_safe_sets.emplace_back(Memory::Allocator<SO6>("thread buffers", Memory::pool("thread buffer[" + std::to_string(k) + "]")));
+        }
+
+        // Parents are indexed once per level, the pattern graph is asked once per parent
+        std::vector<const SO6*> parents;
+        parents.reserve(current.size());
+        for (const SO6 &S : current) parents.push_back(&S);
 
         int insert_counter = 0;
         #pragma omp parallel num_threads(THREADS)
         {
             int thread_id = omp_get_thread_num();
+            Numa::pin_thread(thread_id);
             size_t operation_count = thread_id;  // Thread-local operation count offset by thread
-            #pragma omp for collapse(2) schedule(dynamic)
-            for (size_t i = 0; i < current.size(); ++i)
+            #pragma omp for schedule(dynamic)
+            for (size_t i = 0; i < parents.size(); ++i)
             {
+                const SO6& S = *parents[i];
+                if (prune && !PatternGraph::can_reach(S, target_T_count - curr_T_count)) {
+                    progress.tick(thread_id, 15);
+                    pruned.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
                 #pragma unroll
                 for (int T = 0; T < 15; T++)
                 {                
-                    if (thread_id == 0) {
-                        report_percent_complete(++count, interval_size);
-                    }
-                    auto it = std::next(current.begin(), i);
-                    const SO6& S = *it;
+                    progress.tick(thread_id);
                     SO6 toInsert = S.left_multiply_by_T(T);
                     thread_safe_sets[thread_id].insert(toInsert); 
                     operation_count++;
@@ -503,61 +783,197 @@ int main(int argc, char **argv)
                         {
                             next.insert(thread_safe_sets[thread_id].begin(), thread_safe_sets[thread_id].end());
                             thread_safe_sets[thread_id].clear();  // Clear after inserting into `next`
-                            std::set<SO6>().swap(thread_safe_sets[thread_id]);  // Swap and release memory
+                            SO6Set(thread_safe_sets[thread_id].get_allocator()).swap(thread_safe_sets[thread_id]);  // Nodes return to the thread's pool
                         }
                     }
                 }
             }
         }
         // Combine all thread-safe sets into the next set
-        for (const auto& thread_set : thread_safe_sets)
+        for (auto& thread_set : thread_safe_sets)
         {   
             next.insert(thread_set.begin(), thread_set.end());
+            utils::clear_and_release(thread_set);
         }
 
         utils::setDifference(next,prior);
         utils::rotate_and_clear(prior, current, next); // current is now ready for next iteration
 
+        if (prune) std::cout << " ||\t↪ [Prune] Skipped " << pruned << " matrices more than " << target_T_count - curr_T_count
+                             << " T gates from every remaining pattern\n";
         finish_io(current.size(), true, of);
-        storeCosets(curr_T_count, current, generating_set[curr_T_count]);
+        if (curr_T_count < utils::num_generating_sets(target_T_count, stored_depth_max)) {
+            storeCosets(curr_T_count, current, generating_set[curr_T_count]);
+            sets_saved++;
+        }
+        report_memory(curr_T_count+1, prior, current);
+        if (memory_budget && Globals::replan(curr_T_count+1, sets_saved)) {
+            // A deeper stored level needs fewer cosets, release the ones that are no longer used
+            for (int k = utils::num_generating_sets(target_T_count, stored_depth_max); k < ngs; k++) {
+                SO6Vector(generating_set[k].get_allocator()).swap(generating_set[k]);
+            }
+        }
     }
     
-    std::set<SO6>().swap(prior); // Swap to clear
+    utils::clear_and_release(prior);
     std::cout << " ||\n[End] Stored T=" << (int)stored_depth_max << " as current to generate T=" << stored_depth_max + 1 << " through T=" << (int)target_T_count << "\n" << std::endl;
 
-    std::vector<SO6> to_compute = utils::convert_to_vector_and_clear(current);
+    uint64_t set_size = current.size();
+    std::vector<uint64_t> bounds;   // chunk t is to_compute[bounds[t]] through to_compute[bounds[t+1]-1], one per thread asked for
+    SO6Array to_compute = utils::convert_to_vector_and_clear(current, THREADS, compute_order, order_seed, bounds);
+    if (order_benchmark) {
+        benchmark_orders(to_compute, generating_set);
+        return 0;
+    }
+    // With patterns to find, products are taken by pairs of buckets (SO6::bucket_key) so that pairs whose products have
+    // a known pattern that is not wanted are skipped whole. Chunks keep --order inside each bucket.
+    const bool bucketed = !pattern_file.empty();
+    if (bucketed) {
+        auto by_bucket = [](const SO6 &a, const SO6 &b) { return a.bucket_key() < b.bucket_key(); };
+        for (SO6Vector &g : generating_set) std::sort(g.begin(), g.end(), by_bucket);
+        sort_chunks_by_bucket(to_compute, bounds);
+    }
+    // One stored matrix of every bucket, against which the blocks of the generating set are checked at each level
+    std::vector<uint64_t> stored_buckets;
+    if (bucketed) {
+        std::set<__uint128_t> seen;
+        for (uint64_t i = 0; i < set_size; i++) {
+            if (seen.insert(to_compute[i].bucket_key()).second) stored_buckets.push_back(i);
+        }
+    }
+    std::vector<std::vector<SO6Vector>> replicas = replicate_generating_sets(generating_set);
+    Memory::report("free multiply");
 
     std::cout << "[Report] Current patterns: " << pattern_set.size() << std::endl;
+    PatternIndex::build(pattern_set);
+    if (!pattern_set.empty()) std::cout << "[Report] Indexed the patterns in " << PatternIndex::capacity() << " slots." << std::endl;
+
+    // Graph node of every stored matrix, so that each level looks up labels without recomputing patterns
+    std::vector<int> stored_nodes;
+    if (PatternGraph::built()) {
+        stored_nodes.resize(set_size);
+        #pragma omp parallel num_threads(THREADS)
+        {
+            for (int t = omp_get_thread_num(); t < THREADS; t += omp_get_num_threads()) {
+                for (uint64_t i = bounds[t]; i < bounds[t+1]; i++) stored_nodes[i] = PatternGraph::node(to_compute[i].to_pattern());
+            }
+        }
+    }
 
     std::cout << "[Begin] Beginning brute force multiply.\n ||" << std::endl;
-    uint64_t set_size = to_compute.size();
-    uint64_t interval_size = std::ceil(set_size / THREADS); // Equally divide among threads, not sure how to balance but each should take about the same time
 
     for (int curr_T_count = stored_depth_max; curr_T_count < target_T_count; ++curr_T_count)
     {    
+        if (goal_flag && pattern_set.empty()) {
+            std::cout << " ||\t[Goal] Every pattern was found by T=" << curr_T_count << ", stopping\n";
+            break;
+        }
         std::ofstream of = prepare_T_count_io(curr_T_count+1,stored_depth_max, target_T_count);
+        hit_T_count = curr_T_count+1;
+        // Found patterns pass the filter until it is rebuilt
+        if (PatternIndex::stale()) PatternIndex::build(pattern_set);
 
-        std::vector<std::ofstream> file_stream(THREADS);
-        // for(int i=0; i < THREADS; i++) {
-        //     std::string file_name = "./data/reductions/thread" + std::to_string(i) + ".dat";
-        //     file_stream[i].open(file_name, std::ios::out | std::ios::trunc);
-        // }
+        // A level is skipped as a whole if the labels put every stored matrix beyond its budget
+        const int budget = curr_T_count + 1 - stored_depth_max;
+        if (PatternGraph::built()) {
+            PatternGraph::label(pattern_set);
+            if (std::none_of(stored_nodes.begin(), stored_nodes.end(), [&](const int &n) { return PatternGraph::distance(n) <= budget; })) {
+                std::cout << " ||\t↪ [Prune] No remaining pattern within " << budget << " T gates of a stored matrix, skipping T=" << curr_T_count+1 << "\n";
+                finish_io(0, false, of);
+                continue;
+            }
+        }
+
+        // Blocks of the generating set, its runs of one bucket, and whether each can still give a remaining pattern with
+        // some stored matrix. A level is skipped as a whole once none can.
+        const int level = curr_T_count - stored_depth_max - 1;
+        std::vector<std::size_t> starts;
+        std::vector<char> live;
+        if (level >= 0) {
+            const SO6Vector &gens = generating_set[level];
+            for (std::size_t g = 0; g < gens.size(); g++) {
+                if (g == 0 || (bucketed && gens[g].bucket_key() != gens[g-1].bucket_key())) starts.push_back(g);
+            }
+            starts.push_back(gens.size());
+            live.assign(starts.size() - 1, 1);
+            if (bucketed) {
+                #pragma omp parallel for num_threads(THREADS) schedule(dynamic)
+                for (std::size_t b = 0; b < live.size(); b++) {
+                    live[b] = std::any_of(stored_buckets.begin(), stored_buckets.end(),
+                                          [&](const uint64_t &i) { return outlook(gens[starts[b]], to_compute[i]) != unwanted_pattern; });
+                }
+                if (std::none_of(live.begin(), live.end(), [](const char &l) { return l; })) {
+                    std::cout << " ||\t↪ [Goal] No remaining pattern from any block of the generating set, skipping T=" << curr_T_count+1 << "\n";
+                    finish_io(0, false, of);
+                    continue;
+                }
+            }
+        }
+
+        const int width = product_width(curr_T_count+1);
+        if (curr_T_count+1 > UniformSO6::max_lde) std::cout << " ||\t↪ [Width] Products at T=" << curr_T_count+1 << " use " << width << "-bit entries\n";
+
+        // Generating set of this level in uniform-denominator form, built by the first thread of each node that needs it
+        std::vector<std::vector<UniformSO6>> uniform_gens(std::max<std::size_t>(1, replicas.size()));
+
+        std::atomic<uint64_t> pruned(0), bucket_skipped(0), probed(0), filter_passed(0);
 
         omp_init_lock(&lock);
-        #pragma omp parallel for schedule(static, interval_size) num_threads(THREADS)
-        for (uint64_t i = 0; i < set_size; i++)
+        progress.begin(set_size, THREADS, &patterns_remaining);
+        writer.begin(of, THREADS);
+        #pragma omp parallel num_threads(THREADS)
+        {
+        int current_thread = omp_get_thread_num();
+        Numa::pin_thread(current_thread);
+        const int node = replicas.empty() ? 0 : Numa::node_of_thread(current_thread);
+        const std::vector<SO6Vector> &gens = replicas.empty() ? generating_set : replicas[node];
+        std::vector<UniformSO6> &ugens = uniform_gens[node];
+        if (level >= 0) {
+            #pragma omp critical
+            {
+                if (ugens.empty()) for (const SO6 &G : gens[level]) ugens.emplace_back(G);
+            }
+            #pragma omp barrier
+        }
+
+        // Whether each block can give a remaining pattern with the stored matrices at hand
+        std::vector<char> compatible(live);
+        __uint128_t run_key = ~(__uint128_t) 0;
+        uint64_t skipped = 0, products_probed = 0, passed = 0;
+
+        std::vector<std::size_t> visit(starts.size() > 0 ? starts.size() - 1 : 0);
+
+        // Product patterns that pass the filter are probed in batches, in slot order so the index is walked front to
+        // back. Only hits go on to pattern_set and the output.
+        std::vector<Probe> probes;
+        probes.reserve(probe_batch + (level >= 0 ? gens[level].size() : 0));
+        auto flush = [&]()
+        {
+            std::sort(probes.begin(), probes.end(), [](const Probe &a, const Probe &b) { return a.slot < b.slot; });
+            for (const Probe &probe : probes) {
+                if (!PatternIndex::contains(probe.key) || !erase_pattern(PatternIndex::to_pattern(probe.key))) continue;
+                std::vector<unsigned char> hist(to_compute[probe.i].hist);
+                hist.insert(hist.end(), gens[level][probe.g].hist.begin(), gens[level][probe.g].hist.end());
+                record_pattern(SO6::circuit_string(hist));
+            }
+            probes.clear();
+        };
+        auto multiply = [&](const uint64_t &i)
         {
-            int current_thread = omp_get_thread_num();
-            const SO6 &S = to_compute.at(i); 
-            if (omp_get_thread_num() == 0)
-                report_percent_complete(i % interval_size, interval_size);
+            const SO6 &S = to_compute[i];
+            progress.tick(current_thread);
+            if (goal_flag && patterns_remaining.load(std::memory_order_relaxed) == 0) return;
+            if (!stored_nodes.empty() && PatternGraph::distance(stored_nodes[i]) > budget) {
+                pruned.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
 
             if (curr_T_count == stored_depth_max)
             {
                 SO6 N = S.left_multiply_by_T(0);
                 if(!cases_flag) {
-                    erase_and_record_pattern(N, of);
-                    continue;
+                    erase_and_record_pattern(N);
+                    return;
                 }
 
                 // for(pattern P : cases) {
@@ -568,20 +984,94 @@ int main(int argc, char **argv)
                 // }
             }
  
-            for (const SO6 &G : generating_set[curr_T_count-stored_depth_max - 1])
+            if (bucketed && S.bucket_key() != run_key) {
+                run_key = S.bucket_key();
+                for (std::size_t b = 0; b < visit.size(); b++) compatible[b] = live[b] ? outlook(gens[level][starts[b]], S) : unwanted_pattern;
+                // Buckets whose products are known to be wanted go first
+                std::iota(visit.begin(), visit.end(), 0);
+                if (priority_flag) std::stable_partition(visit.begin(), visit.end(), [&](const std::size_t &b) { return compatible[b] == wanted_pattern; });
+            }
+
+            const UniformSO6 US(S);
+            for (const std::size_t &b : visit)
             {
-                SO6 N = G*S; 
-                if(!cases_flag) {
-                    erase_and_record_pattern(N, of);
+                if (!compatible[b]) {
+                    skipped += starts[b+1] - starts[b];
                     continue;
                 }
+                for (std::size_t g = starts[b]; g < starts[b+1]; g++)
+                {
+                    if (goal_flag && patterns_remaining.load(std::memory_order_relaxed) == 0) break;
+                    if(!cases_flag) {
+                        // Products beyond what UniformSO6 holds are taken entry-wise and probed at once
+                        if (ugens[g].k + US.k > UniformSO6::max_lde) {
+                            erase_and_record_product(gens[level][g], S, width);
+                            continue;
+                        }
+                        uint64_t residues[2];
+                        ugens[g].product_residues(US, residues);
+                        const PatternIndex::Key key = PatternIndex::key(residues);
+                        products_probed++;
+                        if (!PatternIndex::may_contain(key)) continue;
+                        passed++;
+                        probes.push_back({key, PatternIndex::slot(key), i, (uint32_t) g});
+                        continue;
+                    }
+                }
+            }
+            if (probes.size() >= probe_batch) flush();
+        };
+
+        // Chunk t is taken by a thread of the team, so a smaller team than asked for still takes every chunk
+        for (int chunk = current_thread; chunk < THREADS; chunk += omp_get_num_threads()) {
+            if (!priority_flag || level < 0) {
+                std::iota(visit.begin(), visit.end(), 0);
+                for (uint64_t i = bounds[chunk]; i < bounds[chunk+1]; i++) multiply(i);
+            } else {
+                // The chunk is sorted by bucket, so runs are contiguous. They are rescored whenever patterns were found
+                // since the last scoring and a sixteenth of the chunk was multiplied in between.
+                std::vector<Run> runs;
+                for (uint64_t i = bounds[chunk]; i < bounds[chunk+1]; i++) {
+                    if (runs.empty() || to_compute[i].bucket_key() != to_compute[runs.back().begin].bucket_key()) runs.push_back({i, i});
+                    runs.back().end = i + 1;
+                }
+                const uint64_t rescore_interval = (bounds[chunk+1] - bounds[chunk]) / 16 + 1;
+                uint64_t scored_remaining = patterns_remaining.load(std::memory_order_relaxed), since_scoring = 0;
+                score_runs(runs.begin(), runs.end(), to_compute, gens[level], starts);
+                for (auto run = runs.begin(); run != runs.end(); ++run) {
+                    if (since_scoring >= rescore_interval && patterns_remaining.load(std::memory_order_relaxed) != scored_remaining) {
+                        scored_remaining = patterns_remaining.load(std::memory_order_relaxed);
+                        since_scoring = 0;
+                        score_runs(run, runs.end(), to_compute, gens[level], starts);
+                    }
+                    for (uint64_t i = run->begin; i < run->end; i++) multiply(i);
+                    since_scoring += run->end - run->begin;
+                }
             }
         }
+        flush();
+        bucket_skipped.fetch_add(skipped, std::memory_order_relaxed);
+        probed.fetch_add(products_probed, std::memory_order_relaxed);
+        filter_passed.fetch_add(passed, std::memory_order_relaxed);
+        }
         omp_destroy_lock(&lock);
+        if (PatternGraph::built()) std::cout << " ||\t↪ [Prune] Skipped " << pruned << " matrices more than " << budget
+                                             << " T gates from every remaining pattern\n";
+        if (bucketed && level >= 0) {
+            std::size_t products = 0;
+            for (const std::vector<UniformSO6> &ugens : uniform_gens) products = std::max(products, set_size * ugens.size());
+            std::cout << " ||\t↪ [Buckets] Skipped " << bucket_skipped << " of " << products << " products whose pattern is known from the residues and not wanted\n";
+        }
+        if (PatternIndex::built() && probed) std::cout << " ||\t↪ [Filter] " << filter_passed << " of " << probed << " product patterns passed the filter\n";
         finish_io(0, false, of);
-        for(auto &stream : file_stream) stream.close();
     }
     std::cout << " ||\n[Finished] Free multiply complete.\n\n[Time] Total time elapsed: " << time_since(program_init_time) << std::endl;
+    if (!orbit_ids.empty()) {
+        std::ofstream hits("./data/first_hits.dat", ios::out | ios::trunc);
+        for (const std::string &hit : first_hits) hits << hit << "\n";
+        std::cout << "[Goal] Found " << named_hits << " of " << orbit_ids.size()
+                  << " patterns, first hits (T count, time, pattern) in ./data/first_hits.dat" << std::endl;
+    }
     std::cout << " Even calls: " << counter_even << " Odd calls: " << counter_odd << " Zero calls: " << counter_zero << std::endl;
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <set>
 #include <algorithm>
 #include <stdint.h>
 #include "pattern.hpp"
@@ -203,6 +204,57 @@ pattern pattern::transpose() {
     return ret;
 }
 
+/**
+ * @brief The orbit of a pattern: every pattern it gives under row permutations, row modifications and transposition.
+ *        Columns are ordered by lexicographic_order. The least pattern of the set identifies the orbit.
+ *
+ * @param pat The pattern to permute and modify.
+ * @return every pattern of the orbit
+ */
+std::set<pattern> pattern::permutation_set(const pattern &pat)
+{   
+    // Insert the original pattern into the set
+    std::set<pattern> perms;
+    std::set<pattern> inits;
+    inits.insert(pat);
+    inits.insert(pattern(pat).transpose());
+
+    for(pattern p : inits) {
+        perms.insert(p); 
+        // Initialize an array to represent the rows of the pattern
+        int row[6] = {0, 1, 2, 3, 4, 5};
+
+        // Generate all permutations of the pattern
+        while (std::next_permutation(row, row + 6))
+        {
+            // Create a new pattern based on the current permutation
+            pattern perm_of_orig;
+            for (int c = 0; c < 6; c++)
+            {
+                for (int r = 0; r < 6; r++)
+                    perm_of_orig.arr[c][r] = p.arr[c][row[r]];
+            }
+            // Order the new pattern lexicographically and insert it into the set
+            perm_of_orig.lexicographic_order();
+            perms.insert(perm_of_orig);
+            // Iterate over all possible combinations of row modifications
+            for(unsigned int counter = 0; counter < (1 << 6); counter++) {
+                pattern mod_of_perm = perm_of_orig; // Start with a copy of the original permutation
+                for(int j = 0; j < 6; j++) {
+                    if((counter >> j) & 1) {
+                        // Modify the j-th row if the j-th bit of 'counter' is set
+                        mod_of_perm.mod_row(j);
+                    }
+                }
+                // Order the modified pattern lexicographically and insert it into the set
+                mod_of_perm.lexicographic_order();
+                perms.insert(mod_of_perm);
+            }
+        }
+    }
+    return perms;
+}
+
 // void pattern::row_sort_by_column(const int & col) {
 
 // }
@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <vector>
+#include <set>
+#include <algorithm>
 #include <utility> // For std::pair
 #include <functional> // For std::hash
 #include "SO6.hpp"
@@ -20,6 +22,7 @@ class pattern{
         pattern pattern_mod();
         void mod_row(const int &);
         pattern transpose();
+        static std::set<pattern> permutation_set(const pattern &);
         const bool* to_binary() const;
 
         bool operator==(const pattern &) const;
@@ -45,6 +48,12 @@ class pattern{
 
         std::string case_string();
 
+        /// @brief Estimated heap bytes owned by this pattern (hist and id), used by the memory report.
+        size_t heap_footprint() const {
+            auto chunk = [](size_t bytes) -> size_t { return bytes ? std::max<size_t>(32, (bytes + 8 + 15) & ~size_t(15)) : 0; };
+            return chunk(hist.capacity()) + (id.capacity() > 15 ? chunk(id.capacity() + 1) : 0);
+        }
+
         static const pattern identity() {
             pattern I;
             for(int k =0; k<6; k++) {
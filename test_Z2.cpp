@@ -68,6 +68,31 @@ int main() {
             std::cout << "Error: " << a << " + " << b << " = " << c << " != " << d << std::endl;
             return 1;
         }
+        Z2 e = a;
+        e -= b;
+        if (e != slowAdd(a, -b)) {
+            std::cout << "Error: " << a << " - " << b << " = " << slowAdd(a, -b) << " != " << e << std::endl;
+            return 1;
+        }
+    }
+
+    // Batched column add and subtract against entry-wise slowAdd, with zero entries mixed in
+    for(int i = 0; i < totalIterations / 100; ++i) {
+        Z2 col[6], other[6], sum[6], diff[6];
+        for(int row = 0; row < 6; ++row) {
+            col[row] = (rand() % 4) ? Z2((rand() % 10 + 1) * (rand() % 2 ? 1 : -1), rand() % 21 - 10, rand() % 5) : Z2(0,0,0);
+            other[row] = (rand() % 4) ? Z2((rand() % 10 + 1) * (rand() % 2 ? 1 : -1), rand() % 21 - 10, rand() % 5) : Z2(0,0,0);
+            sum[row] = col[row];
+            diff[row] = col[row];
+        }
+        Z2::add(sum, other, 6);
+        Z2::subtract(diff, other, 6);
+        for(int row = 0; row < 6; ++row) {
+            if (sum[row] != slowAdd(col[row], other[row]) || diff[row] != slowAdd(col[row], -other[row])) {
+                std::cout << "Error: batched " << col[row] << " +/- " << other[row] << " = " << sum[row] << ", " << diff[row] << std::endl;
+                return 1;
+            }
+        }
     }
     return 0;
 }
\ No newline at end of file
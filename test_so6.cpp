@@ -5,6 +5,10 @@
 #include <chrono>
 #include "SO6.hpp"            // Include SO6 header
 #include "Z2.hpp"             // Include Z2 header
+#include "UniformSO6.hpp"
+#include "PatternIndex.hpp"
+#include "PatternGraph.hpp"
+#include "Z2Table.hpp"
 #include <iostream>           // For standard input/output
 
 void test_SO6_iterator() {
@@ -117,9 +121,449 @@ void test_SO6_iterator_operations() {
     std::cout << "All iterator tests with non-trivial Row and Col passed!" << std::endl;
 }
 
+/**
+ * @brief Random T circuit of the given length applied to the identity.
+ */
+SO6 random_SO6(std::mt19937 &rng, const int &length) {
+    SO6 ret = SO6::identity();
+    for (int k = 0; k < length; k++) ret = ret.left_multiply_by_T(rng() % 15);
+    return ret;
+}
+
+/**
+ * @brief P * M * Q for random signed permutations P and Q, built entry by entry so that the canonical view is computed from scratch.
+ */
+SO6 random_signed_permutation(std::mt19937 &rng, const SO6 &M) {
+    int p[6] = {0,1,2,3,4,5}, q[6] = {0,1,2,3,4,5};
+    std::shuffle(p, p + 6, rng);
+    std::shuffle(q, q + 6, rng);
+    const unsigned row_signs = rng() % 64, col_signs = rng() % 64;
+    Z2 entries[6][6];
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            entries[col][row] = M[q[col]][p[row]];
+            if ((row_signs >> row ^ col_signs >> col) & 1) entries[col][row].negate();
+        }
+    }
+    return SO6(entries);
+}
+
+/**
+ * @brief M * Q for a random signed permutation Q, built entry by entry so that the canonical view is computed from scratch.
+ */
+SO6 random_column_permutation(std::mt19937 &rng, const SO6 &M) {
+    int q[6] = {0,1,2,3,4,5};
+    std::shuffle(q, q + 6, rng);
+    const unsigned col_signs = rng() % 64;
+    Z2 entries[6][6];
+    for (int col = 0; col < 6; col++) {
+        for (int row = 0; row < 6; row++) {
+            entries[col][row] = M[q[col]][row];
+            if (col_signs >> col & 1) entries[col][row].negate();
+        }
+    }
+    return SO6(entries);
+}
+
+void test_SO6_signed_permutation_invariance() {
+    std::mt19937 rng(31);
+    for (int trial = 0; trial < 2000; trial++) {
+        const SO6 M = random_SO6(rng, 1 + trial % 12);
+        const SO6 N = random_column_permutation(rng, M);
+        assert(N == M);
+        assert(!(N < M) && !(M < N));
+        assert(N.hash() == M.hash());
+    }
+
+    // Rows are not quotiented: the 15 T gates are row permutations of one another and stay apart, and so do the 165
+    // products of two T gates that are not signed permutations, which the identity class collects
+    std::set<SO6> gates, level;
+    for (int i = 0; i < 15; i++) {
+        gates.insert(random_column_permutation(rng, SO6::identity().left_multiply_by_T(i)));
+        for (int j = 0; j < 15; j++) level.insert(random_column_permutation(rng, SO6::identity().left_multiply_by_T(i).left_multiply_by_T(j)));
+    }
+    assert(gates.size() == 15);
+    assert(level.size() == 165 + 1);
+
+    std::cout << "All signed permutation tests passed!" << std::endl;
+}
+
+/**
+ * @brief The baseline's column comparison, kept as the reference for the canonical order. Columns are compared in
+ *        physical row order, each with the sign that makes its first nonzero entry positive, larger entries first.
+ * @return -1 if first comes first, 0 if equal, 1 if second comes first
+ */
+int baseline_compare(const Z2 first[6], const Z2 second[6]) {
+    int row;
+    bool first_is_negative = false, second_is_negative = false;
+    for (row = 0; row < 6; row++) {
+        if (first[row].intPart == 0) {
+            if (second[row].intPart == 0) continue;
+            return 1;
+        }
+        if (second[row].intPart == 0) return -1;
+        first_is_negative = first[row].intPart < 0;
+        second_is_negative = second[row].intPart < 0;
+        break;
+    }
+    for (; row < 6; row++) {
+        const Z2 x = first_is_negative ? -first[row] : first[row];
+        const Z2 y = second_is_negative ? -second[row] : second[row];
+        if (x == y) continue;
+        return y < x ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief The baseline's operator<: columns sorted by baseline_compare, then compared in that order.
+ */
+bool baseline_less(const SO6 &A, const SO6 &B) {
+    auto sorted = [](const SO6 &M) {
+        std::vector<int> cols = {0,1,2,3,4,5};
+        std::sort(cols.begin(), cols.end(), [&](const int &i, const int &j) { return baseline_compare(M[i], M[j]) < 0; });
+        return cols;
+    };
+    const std::vector<int> a = sorted(A), b = sorted(B);
+    for (int col = 0; col < 5; col++) {
+        const int cmp = baseline_compare(A[a[col]], B[b[col]]);
+        if (cmp) return cmp < 0;
+    }
+    return false;
+}
+
+void test_SO6_incremental_canonical_form() {
+    std::mt19937 rng(32);
+    for (int trial = 0; trial < 4000; trial++) {
+        // Short circuits keep zero columns around, so both the kept and the changed branch get exercised
+        const SO6 S = random_SO6(rng, trial % 14);
+        for (int T = 0; T < 15; T++) {
+            const SO6 N = S.left_multiply_by_T(T);
+            SO6 full = N;
+            full.update_lde();
+            assert(N.lde_bits == full.lde_bits);
+            full.canonical_form();
+            for (int w = 0; w < SO6::key_words; w++) assert(N.key[w] == full.key[w]);
+            for (int pos = 0; pos < 6; pos++) assert(N.column_key(N.Col[pos]) == full.column_key(full.Col[pos]));
+        }
+    }
+
+    std::cout << "All incremental canonical form tests passed!" << std::endl;
+}
+
+void test_SO6_baseline_order() {
+    std::mt19937 rng(26);
+    // Short circuits of equal length share long prefixes of their views, so ties go deep
+    for (int trial = 0; trial < 20000; trial++) {
+        const int length = 1 + trial % 6;
+        const SO6 A = random_SO6(rng, length), B = random_column_permutation(rng, random_SO6(rng, length));
+        assert((A < B) == baseline_less(A, B));
+        assert((B < A) == baseline_less(B, A));
+        assert((A == B) == (!baseline_less(A, B) && !baseline_less(B, A)));
+    }
+
+    // Gates 9 to 14 act on rows 2 to 5 only, so canonical columns 0 and 1 stay e_0 and e_1 and the order is decided further in
+    for (int trial = 0; trial < 2000; trial++) {
+        SO6 A = SO6::identity(), B = SO6::identity();
+        for (int k = 0; k < 1 + trial % 5; k++) {
+            A = A.left_multiply_by_T(9 + rng() % 6);
+            B = B.left_multiply_by_T(9 + rng() % 6);
+        }
+        B = random_column_permutation(rng, B);
+        assert((A < B) == baseline_less(A, B));
+        assert((B < A) == baseline_less(B, A));
+        assert((A == B) == (!baseline_less(A, B) && !baseline_less(B, A)));
+        assert(!(A == B) || A.hash() == B.hash());
+    }
+
+    std::cout << "All baseline order tests passed!" << std::endl;
+}
+
+/**
+ * @brief Least patterns of the orbits of the patterns of matrices, each orbit as in pattern::permutation_set.
+ */
+std::set<pattern> orbits_of(const std::set<pattern> &patterns) {
+    std::set<pattern> covered, orbits;
+    for (const pattern &p : patterns) {
+        if (covered.count(p)) continue;
+        std::set<pattern> orbit = pattern::permutation_set(p);
+        orbits.insert(*orbit.begin());
+        covered.insert(orbit.begin(), orbit.end());
+    }
+    return orbits;
+}
+
+/// @brief Pattern of S without its history.
+pattern bare_pattern(const SO6 &S) {
+    pattern p = S.to_pattern();
+    p.hist.clear();
+    return p;
+}
+
+void test_free_multiply_coverage() {
+    // Levels as main builds them: T L_t without L_{t-1}, one matrix per class up to signed column permutations
+    std::vector<std::set<SO6>> levels = {{SO6::identity()}};
+    for (int t = 1; t <= 5; t++) {
+        std::set<SO6> next;
+        for (const SO6 &S : levels.back()) {
+            for (int T = 0; T < 15; T++) next.insert(S.left_multiply_by_T(T));
+        }
+        if (t >= 2) for (const SO6 &S : levels[t-2]) next.erase(S);
+        levels.push_back(std::move(next));
+    }
+    // The level sizes of the baseline, which read rows in physical order
+    assert(levels[1].size() == 15 && levels[2].size() == 165 && levels[3].size() == 1695 && levels[4].size() == 16710);
+
+    // Generating set k is T₀ L_{k+1} without the matrices whose circuit starts with T₀, as storeCosets saves it
+    auto generating_set = [&](const int &k) {
+        std::vector<SO6> gens;
+        for (const SO6 &S : levels[k+1]) {
+            if (SO6::circuit_string(S.hist).back() != '0') gens.push_back(S.left_multiply_by_T(0));
+        }
+        return gens;
+    };
+
+    // At T = s + 2 + k the free multiply takes G S for G in generating set k and S in L_s. Every orbit that T₀ L_{T-1}
+    // reaches must be reached by it, or the quotient of the levels lost products.
+    for (const auto &[T, s] : {std::pair{5, 3}, std::pair{6, 3}, std::pair{6, 4}}) {
+        std::set<pattern> direct, free;
+        for (const SO6 &S : levels[T-1]) direct.insert(bare_pattern(S.left_multiply_by_T(0)));
+        for (const SO6 &G : generating_set(T - s - 2)) {
+            for (const SO6 &S : levels[s]) free.insert(bare_pattern(G * S));
+        }
+        const std::set<pattern> direct_orbits = orbits_of(direct), free_orbits = orbits_of(free);
+        assert(!direct_orbits.empty());
+        assert(std::includes(free_orbits.begin(), free_orbits.end(), direct_orbits.begin(), direct_orbits.end()));
+    }
+
+    std::cout << "All free multiply coverage tests passed!" << std::endl;
+}
+
+void test_Z2_overflow() {
+    // 127² does not fit in 8 bits, and fits in 16
+    Z2::overflow = false;
+    Z2 x(127, 0, 14);
+    Z2 y = x * x;
+    (void) y;
+    assert(Z2::overflow);
+    basic_Z2<int16_t>::overflow = false;
+    basic_Z2<int16_t> wide = basic_Z2<int16_t>(x) * basic_Z2<int16_t>(x);
+    assert(!basic_Z2<int16_t>::overflow);
+    assert(wide.intPart == 127 * 127 && wide.exponent == 28);
+
+    // Entries of products within Z2::max_lde always fit
+    std::mt19937 rng(37);
+    for (int trial = 0; trial < 200; trial++) {
+        SO6 G = random_SO6(rng, 1 + trial % 7), S = random_SO6(rng, 1 + trial % 7);
+        if (G.getLDE() + S.getLDE() > Z2::max_lde) continue;
+        Z2::overflow = false;
+        SO6 P = G * S;
+        assert(!Z2::overflow);
+    }
+    Z2::overflow = false;
+
+    std::cout << "All overflow tests passed!" << std::endl;
+}
+
+/**
+ * @brief Random T circuit applied to the identity until the LDE reaches lde exactly.
+ */
+SO6 random_SO6_of_lde(std::mt19937 &rng, const int &lde) {
+    SO6 ret = SO6::identity();
+    while (ret.getLDE() != lde) ret = ret.getLDE() < lde ? ret.left_multiply_by_T(rng() % 15) : SO6::identity();
+    return ret;
+}
+
+void test_UniformSO6_product_pattern() {
+    std::mt19937 rng(38);
+    for (int trial = 0; trial < 2000; trial++) {
+        // Signed permutations on both sides of both factors
+        SO6 G = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 7));
+        SO6 S = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 7));
+        if (G.getLDE() + S.getLDE() > Z2::max_lde) continue;
+        assert(UniformSO6(G).product_pattern(UniformSO6(S)) == (G * S).to_pattern());
+    }
+
+    // Products at the limit of Z2, and at the limit of UniformSO6 against the widened SO6 product
+    for (int trial = 0; trial < 50; trial++) {
+        const int k = Z2::max_lde / 2 + trial % 5, l = Z2::max_lde - k;
+        SO6 G = random_signed_permutation(rng, random_SO6_of_lde(rng, k));
+        SO6 S = random_signed_permutation(rng, random_SO6_of_lde(rng, l));
+        assert(UniformSO6(G).product_pattern(UniformSO6(S)) == (G * S).to_pattern());
+
+        SO6 H = random_signed_permutation(rng, random_SO6_of_lde(rng, Z2::max_lde));
+        SO6 R = random_signed_permutation(rng, random_SO6_of_lde(rng, UniformSO6::max_lde - Z2::max_lde));
+        assert(UniformSO6(H).product_pattern(UniformSO6(R)) == H.product_pattern<int32_t>(R));
+    }
+
+    std::cout << "All UniformSO6 product pattern tests passed!" << std::endl;
+}
+
+void test_SO6_product_residues() {
+    std::mt19937 rng(45);
+    int known = 0;
+    for (int trial = 0; trial < 2000; trial++) {
+        const SO6 G = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 7));
+        const SO6 S = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 7));
+        if (G.getLDE() + S.getLDE() > Z2::max_lde) continue;
+        uint64_t residues[2];
+        if (!SO6::product_residues(G, S, residues)) continue;
+        const SO6 GS = G * S;
+        assert(SO6::residue_pattern(residues) == GS.to_pattern());
+        assert(GS.getLDE() == G.getLDE() + S.getLDE());
+        known++;
+
+        // Any matrix of the class of S could be the one stored. Its products have the same residues up to a column
+        // permutation, so the same orbit, and the bucket outlook does not depend on the representative
+        const SO6 SQ = random_column_permutation(rng, S);
+        uint64_t permuted[2];
+        assert(SO6::product_residues(G, SQ, permuted));
+        assert(*pattern::permutation_set(SO6::residue_pattern(permuted)).begin() == *pattern::permutation_set(SO6::residue_pattern(residues)).begin());
+    }
+    assert(known > 0);
+
+    std::cout << "All SO6 product residue tests passed!" << std::endl;
+}
+
+void test_residue_key() {
+    std::mt19937 rng(41);
+    for (int trial = 0; trial < 2000; trial++) {
+        const SO6 S = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 10));
+        assert(PatternIndex::key(S.residue) == PatternIndex::key(S.to_pattern()));
+
+        const SO6 G = random_SO6(rng, 1 + trial % 7);
+        uint64_t residues[2];
+        UniformSO6(G).product_residues(UniformSO6(S), residues);
+        assert(PatternIndex::key(residues) == PatternIndex::key(UniformSO6(G).product_pattern(UniformSO6(S))));
+    }
+
+    std::cout << "All residue key tests passed!" << std::endl;
+}
+
+void test_PatternIndex() {
+    std::mt19937 rng(49);
+    PatternSet targets(Memory::Allocator<pattern>("test patterns"));
+    for (int trial = 0; trial < 4000; trial++) {
+        pattern p = random_signed_permutation(rng, random_SO6(rng, 1 + trial % 9)).to_pattern();
+        p.lexicographic_order();
+        targets.insert(p);
+    }
+    PatternIndex::build(targets);
+    assert(!PatternIndex::stale());
+
+    // Every indexed pattern is found, and comes back from its key
+    for (const pattern &p : targets) {
+        const PatternIndex::Key k = PatternIndex::key(p);
+        assert(PatternIndex::may_contain(k) && PatternIndex::contains(k));
+        assert(PatternIndex::to_pattern(k) == p);
+        assert(PatternIndex::key(PatternIndex::to_pattern(k)) == k);
+    }
+
+    // Erased patterns are gone, and their tombstones keep the others reachable
+    std::vector<pattern> erased;
+    for (const pattern &p : targets) {
+        if (erased.size() * 2 < targets.size()) erased.push_back(p);
+    }
+    std::shuffle(erased.begin(), erased.end(), rng);
+    for (std::size_t n = 0; n < erased.size(); n++) {
+        PatternIndex::erase(erased[n]);
+        assert(!PatternIndex::contains(PatternIndex::key(erased[n])));
+        // A sixteenth of the indexed patterns must be erased before a rebuild
+        assert(PatternIndex::stale() == ((n + 1) * 16 >= targets.size()));
+    }
+    for (const pattern &p : erased) targets.erase(p);
+    for (const pattern &p : targets) assert(PatternIndex::contains(PatternIndex::key(p)));
+
+    PatternIndex::build(targets);
+    assert(!PatternIndex::stale());
+    for (const pattern &p : targets) assert(PatternIndex::contains(PatternIndex::key(p)));
+    for (const pattern &p : erased) assert(!PatternIndex::contains(PatternIndex::key(p)));
+
+    std::cout << "All pattern index tests passed!" << std::endl;
+}
+
 // Main function for running tests
+void test_PatternGraph() {
+    THREADS = 2;
+    std::vector<std::set<SO6>> levels = {{SO6::identity()}};
+    for (int t = 1; t <= 4; t++) {
+        std::set<SO6> next;
+        for (const SO6 &S : levels.back()) {
+            for (int T = 0; T < 15; T++) next.insert(S.left_multiply_by_T(T));
+        }
+        if (t >= 2) for (const SO6 &S : levels[t-2]) next.erase(S);
+        levels.push_back(std::move(next));
+    }
+    PatternGraph::build(SO6::identity(), 4);
+
+    // Targets among the patterns of T=4, so that most nodes are a few T gates away
+    std::mt19937 rng(43);
+    PatternSet targets(Memory::Allocator<pattern>("test patterns"));
+    std::vector<SO6> deepest(levels[4].begin(), levels[4].end());
+    for (int k = 0; k < 20; k++) targets.insert(bare_pattern(deepest[rng() % deepest.size()]));
+    PatternGraph::label(targets);
+
+    // Every transition out of a matrix below the sampled depth is an edge, whatever the other matrices of its pattern do
+    for (int t = 0; t < 4; t++) {
+        for (const SO6 &S : levels[t]) {
+            const int from = PatternGraph::distance(bare_pattern(S));
+            assert(PatternGraph::node(bare_pattern(S)) >= 0);
+            for (int T = 0; T < 15; T++) {
+                const int to = PatternGraph::distance(bare_pattern(S.left_multiply_by_T(T)));
+                assert(to == PatternGraph::unreachable || from <= to + 1);
+            }
+        }
+    }
+    for (const pattern &p : targets) assert(PatternGraph::distance(p) == 0);
+
+    std::cout << "All pattern graph tests passed!" << std::endl;
+}
+
+void test_Z2Table() {
+    // Circuits are drawn and run with arithmetic first, as nothing has built the table yet
+    assert(!Z2Table::built());
+    std::mt19937 rng(35);
+    std::vector<std::vector<int>> circuits;
+    std::vector<SO6> arithmetic;
+    for (int trial = 0; trial < 3000; trial++) {
+        std::vector<int> circuit(trial % 14);
+        for (int &T : circuit) T = rng() % 15;
+        SO6 S = SO6::identity();
+        for (const int &T : circuit) S = S.left_multiply_by_T(T);
+        circuits.push_back(circuit);
+        arithmetic.push_back(S);
+    }
+
+    assert(Z2Table::build(7) == 7);
+    assert(Z2Table::size() == 183);
+    for (int o = 0; o < Z2Table::size(); o++) assert(Z2Table::ordinal(Z2Table::entry(o)) == o);
+
+    for (std::size_t k = 0; k < circuits.size(); k++) {
+        SO6 S = SO6::identity();
+        for (const int &T : circuits[k]) S = S.left_multiply_by_T(T);
+        const SO6 &A = arithmetic[k];
+        for (int i = 0; i < 36; i++) assert(S.arr[i] == A.arr[i]);
+        assert(S.getLDE() == A.getLDE() && S.lde_bits == A.lde_bits);
+        assert(S.residue[0] == A.residue[0] && S.residue[1] == A.residue[1]);
+        for (int w = 0; w < SO6::key_words; w++) assert(S.key[w] == A.key[w]);
+    }
+
+    std::cout << "All Z2Table tests passed!" << std::endl;
+}
+
 int main(int argc, char **argv) {
     test_SO6_iterator_operations();
+    test_SO6_signed_permutation_invariance();
+    test_SO6_incremental_canonical_form();
+    test_SO6_baseline_order();
+    test_free_multiply_coverage();
+    test_Z2_overflow();
+    test_UniformSO6_product_pattern();
+    test_SO6_product_residues();
+    test_residue_key();
+    test_PatternIndex();
+    test_PatternGraph();
+    test_Z2Table();
     // // Create an instance of SO6
     SO6 first = SO6::identity();
     // first.canonical_form_test();
@@ -5,11 +5,69 @@
 #include <set>
 #include <algorithm>
 #include <random>
+#include <stdexcept>
 #include <sstream>
 #include <bitset>
+#include <memory>
+#include <utility>
 #include "Z2.hpp"
 #include "SO6.hpp"
+#include "Memory.hpp"
+#include "Numa.hpp"
+#include <omp.h>
 
+using SO6Set = std::set<SO6, std::less<SO6>, Memory::Allocator<SO6>>;   // level sets and per-thread buffers
+using SO6Vector = std::vector<SO6, Memory::Allocator<SO6>>;             // the generating sets
+
+/**
+ * @brief Fixed-size array of SO6 (to_compute) whose elements are copy-constructed in place by the threads that multiply
+ *        them. A std::vector constructs every element on the calling thread, which would place all of to_compute, and
+ *        the histories it owns, on that thread's node.
+ */
+class SO6Array {
+    public:
+        /**
+         * @brief Copies *from[i] into element i, for i in [bounds[t], bounds[t+1]) on thread t of threads.
+         */
+        SO6Array(const std::vector<const SO6*> &from, const std::vector<uint64_t> &bounds, const int &threads, const Memory::Allocator<SO6> &a)
+            : alloc(a), n(from.size()), elements(n ? alloc.allocate(n) : nullptr)
+        {
+            #pragma omp parallel num_threads(threads)
+            {
+                // Chunks are taken by stride so that all are constructed even if fewer threads were granted
+                for (int t = omp_get_thread_num(); t < threads; t += omp_get_num_threads()) {
+                    Numa::pin_thread(t);
+                    for (uint64_t i = bounds[t]; i < bounds[t + 1]; i++) ::new (static_cast<void*>(elements + i)) SO6(*from[i]);
+                }
+            }
+        }
+        SO6Array(SO6Array &&o) noexcept : alloc(o.alloc), n(std::exchange(o.n, 0)), elements(std::exchange(o.elements, nullptr)) {}
+        SO6Array(const SO6Array &) = delete;
+        SO6Array &operator=(const SO6Array &) = delete;
+        ~SO6Array() {
+            if (!elements) return;
+            std::destroy(elements, elements + n);
+            alloc.deallocate(elements, n);
+        }
+
+        inline std::size_t size() const { return n; }
+        inline bool empty() const { return n == 0; }
+        inline SO6 *begin() { return elements; }
+        inline SO6 *end() { return elements + n; }
+        inline const SO6 *begin() const { return elements; }
+        inline const SO6 *end() const { return elements + n; }
+        inline SO6 &operator[](const std::size_t &i) { return elements[i]; }
+        inline const SO6 &operator[](const std::size_t &i) const { return elements[i]; }
+        inline const SO6 &at(const std::size_t &i) const {
+            if (i >= n) throw std::out_of_range("SO6Array::at");
+            return elements[i];
+        }
+
+    private:
+        Memory::Allocator<SO6> alloc;
+        std::size_t n;
+        SO6 *elements;
+};
 
 /**
  * @file utils.hpp
@@ -27,18 +85,94 @@ public:
         return target_T_count - stored_depth_max;
     }
 
+    /// @brief Orders of to_compute: seeded shuffle, by estimated cost (LDE and sparsity), or by residues so neighbours share bucket pairs.
+    enum class Order { Shuffle, Cost, Residue };
+
+    static Order parse_order(const std::string &name) {
+        if (name == "shuffle") return Order::Shuffle;
+        if (name == "cost") return Order::Cost;
+        if (name == "residue") return Order::Residue;
+        throw std::invalid_argument("order must be shuffle, cost or residue, not " + name);
+    }
+
+    static std::string order_name(const Order &order) {
+        return order == Order::Shuffle ? "shuffle" : order == Order::Cost ? "cost" : "residue";
+    }
+
     /**
-     * @brief Converts a set of SO6s to a shuffled vector and clears the set.
+     * @brief Estimated cost of multiplying S by one generator in the free multiply. UniformSO6 does an axpy per nonzero
+     *        entry of S, or a column select if S is a signed permutation, and then one pass over the 36 entries of the
+     *        product for its pattern.
+     */
+    static uint64_t product_cost(const SO6 &S) {
+        if (S.getLDE() == 0) return 36 + 6;
+        int nonzero = 0;
+        for (int col = 0; col < 6; col++) nonzero += __builtin_popcount(S.nonzero_mask(col));
+        return 36 + nonzero;
+    }
+
+    /**
+     * @brief Puts matrices in the given order. Sorts are stable, so every order only depends on the input order and the seed.
+     */
+    static void order(std::vector<const SO6*> &v, const Order &order, const uint64_t &seed) {
+        switch (order) {
+            case Order::Shuffle: {
+                std::mt19937_64 g(seed);
+                std::shuffle(v.begin(), v.end(), g);
+                break;
+            }
+            case Order::Cost:
+                std::stable_sort(v.begin(), v.end(), [](const SO6 *a, const SO6 *b) {
+                    return std::make_pair(a->getLDE(), product_cost(*a)) < std::make_pair(b->getLDE(), product_cost(*b));
+                });
+                break;
+            case Order::Residue:
+                std::stable_sort(v.begin(), v.end(), [](const SO6 *a, const SO6 *b) { return a->bucket_key() < b->bucket_key(); });
+                break;
+        }
+    }
+
+    /**
+     * @brief Splits ordered matrices into one contiguous chunk per thread of about equal total product_cost.
+     * @return threads + 1 bounds, thread t owns [bounds[t], bounds[t+1])
+     */
+    static std::vector<uint64_t> cost_chunks(const std::vector<const SO6*> &v, const int &threads) {
+        std::vector<uint64_t> prefix(v.size() + 1, 0);
+        for (std::size_t i = 0; i < v.size(); i++) prefix[i + 1] = prefix[i] + product_cost(*v[i]);
+        std::vector<uint64_t> bounds(threads + 1, v.size());
+        for (int t = 0; t < threads; t++) {
+            bounds[t] = std::lower_bound(prefix.begin(), prefix.end(), prefix.back() * t / threads) - prefix.begin();
+        }
+        return bounds;
+    }
+
+    /**
+     * @brief Converts a set of SO6s to an ordered array and clears the set.
+     *
+     * The array is laid out for the free multiply loop, which hands thread t the elements in [bounds[t], bounds[t+1]).
+     * Each thread copy-constructs the elements of its own chunk, which first touches their pages and allocates their heap
+     * (SO6::hist), so with pinned threads every chunk lives on the NUMA node that reads it.
      * @param s Set of SO6 to be converted.
-     * @return A shuffled vector containing the elements originally in the set.
+     * @param threads Number of threads of the free multiply.
+     * @param order Order of the vector, see utils::order.
+     * @param seed Seed of the shuffle.
+     * @param bounds Set to the chunk bounds from cost_chunks.
+     * @param alloc Allocator (and thus memory account) of the returned vector.
+     * @return An array containing the elements originally in the set.
      */
-    static std::vector<SO6> convert_to_vector_and_clear(std::set<SO6>& s) {
-        std::vector<SO6> v(std::make_move_iterator(s.begin()), std::make_move_iterator(s.end()));
-        s.clear(); // Clear the set
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(v.begin(), v.end(), g);
-        return v;  // Return vector
+    static SO6Array convert_to_vector_and_clear(SO6Set& s, const int &threads, const Order &order, const uint64_t &seed, std::vector<uint64_t> &bounds,
+                                                const Memory::Allocator<SO6> &alloc = Memory::Allocator<SO6>("to_compute")) {
+        // Order pointers rather than matrices
+        std::vector<const SO6*> ordered;
+        ordered.reserve(s.size());
+        for (const SO6 &S : s) ordered.push_back(&S);
+        utils::order(ordered, order, seed);
+        bounds = cost_chunks(ordered, threads);
+
+        SO6Array v(ordered, bounds, threads, alloc);
+        ordered.clear();
+        clear_and_release(s);
+        return v;
     }
 
     static std::string convert_csv_line_to_binary(const std::string& line) {
@@ -78,22 +212,32 @@ public:
      * @param A Set from which elements will be erased.
      * @param B Set containing elements to be removed from A.
      */
-    template<typename T>
-    static void setDifference(std::set<T>& A, const std::set<T>& B) {
+    template<typename Set>
+    static void setDifference(Set& A, const Set& B) {
         for (auto it = B.begin(); it != B.end(); ++it) {
             A.erase(*it);
         }
     }
 
 
+    /**
+     * @brief Clears a set and, if it allocates from a node pool, returns the pool's slabs wholesale.
+     * @param s Set to be cleared.
+     */
+    static void clear_and_release(SO6Set& s) {
+        NodePool *pool = s.get_allocator().pool;
+        SO6Set(s.get_allocator()).swap(s);
+        if (pool) pool->release();
+    }
+
     /**
      * @brief Rotates and clears sets for the next iteration.
      * @param prior Set to be cleared.
      * @param current Set to be moved to prior.
      * @param next Set to be moved to current.
      */
-    static void rotate_and_clear(std::set<SO6>& prior, std::set<SO6>& current, std::set<SO6>& next) {
-        std::set<SO6>().swap(prior); // Clear prior
+    static void rotate_and_clear(SO6Set& prior, SO6Set& current, SO6Set& next) {
+        clear_and_release(prior); // Clear prior
         prior.swap(current); // Move current to prior
         current.swap(next); // Move next to current
     }